@@ -0,0 +1,44 @@
+#ifndef BIT_VECTOR_HPP
+#define BIT_VECTOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "DataType.hpp"
+
+// Bits packed 64 to a word. Coefficients mod q are stored as k-bit fields,
+// most significant bit first, in the same order the string pipeline used.
+class BitVector {
+ public:
+  BitVector();
+  explicit BitVector(size_t bits);
+
+  size_t size() const;
+
+  // Bit i as 0 or 1
+  unsigned int get(size_t i) const;
+  void set(size_t i, unsigned int bit);
+
+  // Write count k-bit coefficients starting at bit offset, and read them back
+  void packCoefficients(size_t offset, const BigInt* values, size_t count,
+                        unsigned int k);
+  void unpackCoefficients(size_t offset, BigInt* values, size_t count,
+                          unsigned int k) const;
+
+  // Decode slot values w_i in [0, q) starting at bit offset: bit i is 1 when
+  // w_i is within q / 4 of q / 2
+  void decodeSlots(size_t offset, const BigInt* w, size_t count, BigInt q);
+
+  // Bits [first, first + count) as a string of '0' and '1'
+  string toString(size_t first, size_t count) const;
+
+ private:
+  size_t bits;
+  vector<uint64_t> words;
+
+  // The k bits starting at bit p, bit p being the lowest
+  uint64_t field(size_t p, unsigned int k) const;
+};
+
+#endif  // BIT_VECTOR_HPP
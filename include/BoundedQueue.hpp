@@ -0,0 +1,107 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DataType.hpp"
+
+// Lock-free bounded multi-producer multi-consumer queue (D. Vyukov). Each
+// cell carries a sequence number telling producers and consumers whose turn
+// it is, so a push or pop is one CAS on a shared position in the common case.
+// The capacity is rounded up to a power of two.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity)
+      : cells(roundUp(capacity)), mask(cells.size() - 1) {
+    for (size_t i = 0; i < cells.size(); i++) {
+      cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    head.store(0, memory_order_relaxed);
+    tail.store(0, memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Push value, returns false if the queue is full
+  bool tryPush(T&& value) {
+    size_t pos = tail.load(memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(memory_order_acquire);
+      ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(pos + 1, memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(memory_order_relaxed);
+      }
+    }
+  }
+
+  // Pop into value, returns false if the queue is empty
+  bool tryPop(T& value) {
+    size_t pos = head.load(memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(memory_order_acquire);
+      ptrdiff_t diff =
+          static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+          value = std::move(cell.value);
+          cell.sequence.store(pos + mask + 1, memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(memory_order_relaxed);
+      }
+    }
+  }
+
+  // Approximate number of queued values
+  size_t size() const {
+    size_t t = tail.load(memory_order_relaxed);
+    size_t h = head.load(memory_order_relaxed);
+    return t > h ? t - h : 0;
+  }
+
+  size_t capacity() const { return cells.size(); }
+
+ private:
+  struct Cell {
+    atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t roundUp(size_t n) {
+    if (n == 0) {
+      throw invalid_argument("BoundedQueue: capacity must be positive");
+    }
+    size_t size = 1;
+    while (size < n) {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  vector<Cell> cells;
+  const size_t mask;
+  // Kept on separate cache lines so producers and consumers do not contend
+  alignas(64) atomic<size_t> head;
+  alignas(64) atomic<size_t> tail;
+};
+
+#endif  // BOUNDED_QUEUE_HPP
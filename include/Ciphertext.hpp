@@ -0,0 +1,35 @@
+#ifndef CIPHERTEXT_HPP
+#define CIPHERTEXT_HPP
+
+#include <vector>
+
+#include "Matrix.hpp"
+
+// IB-ME ciphertext (c1, c2). c1 holds one residue per slot and c2 the
+// length entries of the second component, each in one contiguous array.
+class Ciphertext {
+ public:
+  Ciphertext();
+  Ciphertext(unsigned int slots, unsigned int length);
+
+  unsigned int getSlots() const;
+  unsigned int getLength() const;
+
+  // Raw views of the two components
+  BigInt* c1();
+  const BigInt* c1() const;
+  BigInt* c2();
+  const BigInt* c2() const;
+
+  // c1_i as a 1 x 1 matrix
+  Matrix getC1(unsigned int i) const;
+
+  // c2 as a length x 1 matrix
+  Matrix getC2() const;
+
+ private:
+  vector<BigInt> c1Data;
+  vector<BigInt> c2Data;
+};
+
+#endif  // CIPHERTEXT_HPP
@@ -0,0 +1,134 @@
+#ifndef CRYPTO_CONTEXT_HPP
+#define CRYPTO_CONTEXT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "DataType.hpp"
+
+class GadgetSampler;
+
+// Everything the arithmetic and the samplers used to keep in process-wide
+// statics: the modulus and gadget length, the gadget sampler and its oracle
+// table, the G^-1 method and the random generators. Matrix and MP12 work
+// with the context installed on the calling thread by a Scope, or with the
+// process default one when there is none. ThreadPool runs every task under
+// the context of the thread that queued it, so an IBME instance owning its
+// own context never shares mutable state with another one.
+class CryptoContext {
+ public:
+  // How MP12 answers each G^-1 coordinate: DIRECT samples the gadget
+  // lattice digit by digit, ORACLE looks the residue up in the oracle table
+  enum GInverseMethod { DIRECT, ORACLE };
+
+  // Oracle table of q * k Gaussian samples x in Z^k, grouped by the residue
+  // <g, x> mod q. Samples are stored one after another (column-major) and
+  // the samples with residue u are those in [offsets[u], offsets[u + 1]).
+  struct OracleTable {
+    unsigned int k;
+    vector<BigInt> samples;
+    vector<unsigned int> offsets;
+  };
+
+  // Installs a context on the calling thread for the lifetime of the scope
+  class Scope {
+   public:
+    explicit Scope(CryptoContext& context);
+    explicit Scope(CryptoContext* context);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    CryptoContext* previous;
+  };
+
+  // A context without modulus, the generators are seeded from
+  // random_device unless a seed is given
+  CryptoContext();
+  explicit CryptoContext(uint64_t seed);
+  // A context ready for MP12, see configure()
+  CryptoContext(BigInt q, double stddev);
+  CryptoContext(BigInt q, double stddev, uint64_t seed);
+  ~CryptoContext();
+
+  CryptoContext(const CryptoContext&) = delete;
+  CryptoContext& operator=(const CryptoContext&) = delete;
+
+  // Context of the calling thread
+  static CryptoContext& current() {
+    return active != nullptr ? *active : processDefault();
+  }
+  // Context installed by a Scope on the calling thread, nullptr if none
+  static CryptoContext* installed() { return active; }
+
+  BigInt getModulus() const { return modulus; }
+  unsigned int getK() const { return k; }
+  double getStddev() const { return stddev; }
+
+  // Set the modulus and the gadget length k = ceil(log2(q)). A different
+  // modulus drops the gadget sampler and the oracle table built for the
+  // previous one.
+  void setModulus(BigInt q);
+  // Set the modulus and build the gadget sampler of width stddev. Does
+  // nothing if the context is already configured that way. Neither this
+  // nor setModulus may run while other threads use the context.
+  void configure(BigInt q, double stddev);
+
+  // Gadget sampler, throws if configure() was not called
+  const GadgetSampler& getGadget() const;
+  bool hasGadget() const { return gadget != nullptr; }
+
+  void setGInverseMethod(GInverseMethod m) { method = m; }
+  GInverseMethod getGInverseMethod() const { return method; }
+
+  // Oracle table, built on first use by any thread
+  const OracleTable& getOracleTable();
+  bool hasOracleTable() const { return table.load() != nullptr; }
+
+  // Random generator of the calling thread for this context. The thread
+  // that created the context always draws stream 0 of the seed, so with a
+  // fixed seed everything sampled on that thread repeats from run to run.
+  // Any other thread gets the next unused stream when it first draws; which
+  // thread gets which stream, and which thread runs which pool task, depends
+  // on scheduling, so draws made on pool or producer threads do not repeat.
+  mt19937& rng();
+
+  // Start the creator thread's stream over from stream 0 of seed, e.g. so a
+  // benchmark draws the same values whatever ran before it. Only the
+  // creator thread may call this.
+  void restart(uint64_t seed);
+
+  uint64_t getSeed() const { return seed; }
+
+ private:
+  static CryptoContext& processDefault();
+  void buildOracleTable();
+
+  static thread_local CryptoContext* active;
+  static atomic<uint64_t> nextId;
+
+  const uint64_t id;  // tells contexts apart in the per-thread generator
+  const uint64_t seed;
+  const thread::id creator;
+  mt19937 creatorGenerator;  // stream 0, only used by the creator thread
+  atomic<uint64_t> streams;  // generator streams handed out so far
+
+  BigInt modulus;
+  unsigned int k;
+  double stddev;
+  unique_ptr<GadgetSampler> gadget;
+  GInverseMethod method;
+
+  mutex tableMtx;
+  unique_ptr<OracleTable> tableStorage;
+  atomic<const OracleTable*> table;
+};
+
+#endif  // CRYPTO_CONTEXT_HPP
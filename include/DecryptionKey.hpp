@@ -0,0 +1,39 @@
+#ifndef DECRYPTION_KEY_HPP
+#define DECRYPTION_KEY_HPP
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "KeyBlock.hpp"
+#include "Tree.hpp"
+
+// Keys of a set of tree nodes, e.g. the path of a receiver or the cover of
+// an epoch. Blocks are shared, so a decryption key can reference them. A key
+// update lists its nodes in heap index order, DKGen relies on it.
+typedef vector<pair<TreeNode*, shared_ptr<const KeyBlock>>> NodeKeys;
+
+// Decryption key of a receiver at one epoch: the receiver key and the key
+// update of the node where the receiver path meets the update cover. It
+// only holds references to the two blocks, building one copies nothing.
+class DecryptionKey {
+ public:
+  DecryptionKey();
+  DecryptionKey(unsigned int node, shared_ptr<const KeyBlock> receiverKey,
+                shared_ptr<const KeyBlock> keyUpdate);
+
+  bool empty() const;
+
+  // Heap index of the shared node
+  unsigned int getNode() const;
+
+  const KeyBlock& getReceiverKey() const;
+  const KeyBlock& getKeyUpdate() const;
+
+ private:
+  unsigned int node;
+  shared_ptr<const KeyBlock> receiverKey;
+  shared_ptr<const KeyBlock> keyUpdate;
+};
+
+#endif  // DECRYPTION_KEY_HPP
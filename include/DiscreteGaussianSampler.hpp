@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include <vector>
 
+#include "CryptoContext.hpp"
 #include "DataType.hpp"
 
 
@@ -17,7 +18,6 @@ class DiscreteGaussianSampler {
   double m_a;
   vector<double> m_vals;
   BigInt modulus;           // Modulus
-  static mt19937 gen;  // Random number generator
 
   size_t FindInVector(const vector<double>& S, double search) const;
 
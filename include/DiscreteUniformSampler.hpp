@@ -5,6 +5,7 @@
 #include <random>
 #include <stdexcept>
 
+#include "CryptoContext.hpp"
 #include "DataType.hpp"
 
 class DiscreteUniformSampler {
@@ -14,7 +15,6 @@ class DiscreteUniformSampler {
 
  private:
   BigInt modulus;           // Modulus
-  static mt19937 gen;  // Random number generator
 };
 
 #endif  // DISCRETE_UNIFORM_SAMPLER_HPP
\ No newline at end of file
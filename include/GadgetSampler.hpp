@@ -0,0 +1,73 @@
+#ifndef GADGET_SAMPLER_HPP
+#define GADGET_SAMPLER_HPP
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "DataType.hpp"
+
+// Sampler for the gadget lattice coset {x in Z^k : <g, x> = u mod q} with
+// g = (1, 2, ..., 2^(k-1)) and an arbitrary modulus q, following Genise and
+// Micciancio (EUROCRYPT 2018). The basis B_q of the lattice is factored as
+// S * D, where S is the power-of-two basis and D is the identity with the
+// last column replaced by d = S^-1 (bits of q). A sample is then a
+// target-independent perturbation p followed by a randomized nearest plane
+// over D, digit by digit. Only one small table per Gaussian width is kept.
+class GadgetSampler {
+ public:
+  GadgetSampler(BigInt q, double stddev);
+
+  // Write k integers x with <g, x> = u mod q, distributed close to a
+  // discrete Gaussian with standard deviation stddev over that coset
+  void sample(BigInt u, BigInt* x, mt19937& rng) const;
+
+  // Target-independent half of sample(): a perturbation p in Z^k with
+  // covariance stddev^2 I - sigma^2 S S^T, sigma = stddev / 3
+  void perturb(BigInt* p, mt19937& rng) const;
+
+  // Target-dependent half of sample(), given a perturbation from perturb()
+  void sampleWithPerturbation(BigInt u, const BigInt* p, BigInt* x,
+                              mt19937& rng) const;
+
+  unsigned int getK() const;
+  BigInt getModulus() const;
+  double getStddev() const;
+
+ private:
+  // Table for D_{Z, width, c}, sampled as a zero-centered table draw that is
+  // shifted to the integer part of c and accepted by rejection
+  struct Table {
+    double width;
+    vector<double> cdf;  // cumulative weights of |y| = 0, 1, ...
+    double logBound;     // log of the rejection sampling bound
+  };
+
+  static Table makeTable(double width);
+  static BigInt sampleZ(const Table& table, double center, mt19937& rng);
+
+  // Bodies of perturb() and sampleWithPerturbation(). digits and modulus are
+  // compile-time constants for the named parameter sets, so the digit loops
+  // unroll and the reduction of u is a multiply.
+  template <class Digits>
+  void perturbFor(Digits digits, BigInt* p, mt19937& rng) const;
+  template <class Digits, class Modulus>
+  void sampleFor(Digits digits, Modulus modulus, BigInt u, const BigInt* p,
+                 BigInt* x, mt19937& rng) const;
+
+  BigInt q;
+  unsigned int k;
+  double stddev;
+  double sigma;
+  vector<int> qBits;  // binary digits of q, least significant first
+  vector<double> d;   // last column of D
+  vector<double> l;   // diagonal of L, with L^T L = 9I - S S^T
+  vector<double> h;   // subdiagonal of L, h[i] at (i, i - 1)
+
+  vector<Table> perturbTables;  // width sigma / l[i], one per digit
+  Table digitTable;             // width sigma
+  Table lastTable;              // width sigma / d[k - 1]
+};
+
+#endif  // GADGET_SAMPLER_HPP
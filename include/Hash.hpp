@@ -6,6 +6,8 @@
 
 #include "Matrix.hpp"
 
+// Copying a SHA256 or SHAKE128 object clones its midstate, so a prefix can be
+// absorbed once and then continued with many different suffixes.
 class SHA256 {
  public:
   SHA256();
@@ -16,12 +18,41 @@ class SHA256 {
   static const size_t BlockSize = 64;
   static const size_t HashSize = 32;
 
+  // Compression cores: the portable one, eight AVX2 lanes for hashCounter,
+  // and SHA-NI. The fastest one the CPU supports is picked at start up.
+  enum Core { SCALAR, AVX2, SHANI };
+  static Core activeCore();
+  static bool supportsCore(Core core);
+  // Switch to core, e.g. for tests to check every core against the others.
+  // Returns false and keeps the current core if the CPU lacks it. Not safe
+  // while other threads are hashing.
+  static bool forceCore(Core core);
+
   static array<uint8_t, 32> hash(const string& input);
 
+  // Hash count independent messages input || LE32(first + j), writing the
+  // digests back to back into out (count * HashSize bytes). Lanes are
+  // compressed together with SHA-NI or AVX2 when the CPU supports them.
+  static void hashCounter(const uint8_t* input, size_t length, uint32_t first,
+                          size_t count, uint8_t* out);
+
+  // Same, continuing from a cloned midstate that has already absorbed a
+  // common prefix
+  static void hashCounter(const SHA256& prefix, const uint8_t* input,
+                          size_t length, uint32_t first, size_t count,
+                          uint8_t* out);
+
  private:
   static const size_t InitialValues[8];
   static const uint32_t K[64];
 
+  // Compress blocks into a single state with the fastest available core
+  static void compress(uint32_t* state, const uint8_t* blocks, size_t count);
+
+  // Compress one block per lane for up to eight independent states
+  static void compressLanes(uint32_t (*states)[8], const uint8_t* const* blocks,
+                            size_t lanes);
+
   void transform(const uint8_t* chunk);
   void pad();
   void revert(uint8_t* hash);
@@ -32,14 +63,54 @@ class SHA256 {
   uint32_t state[8];
 };
 
+class SHAKE128 {
+ public:
+  SHAKE128();
+  void update(const uint8_t* data, size_t length);
+  void finalize();
+  void squeeze(uint8_t* out, size_t length);
+
+  static const size_t Rate = 168;
+
+ private:
+  // Keccak-f[1600] permutation
+  static void permute(uint64_t* state);
+
+  uint64_t state[25];
+  size_t pos;
+  bool finalized;
+};
+
+enum class HashBackend {
+  SHA256_CTR,    // SHA-256 in counter mode, 64-bit chunks reduced mod q
+  SHAKE128_XOF,  // SHAKE128 stream, rejection sampled into [0, q)
+};
+
 class Hash {
  public:
-  Hash(int r, int c);
+  Hash(int r, int c, HashBackend backend = HashBackend::SHA256_CTR);
+
+  // Expand input into a rows x cols matrix over Z_q with the selected backend
   Matrix hash(const string& input);
 
+  // Return a copy whose hash(input) computes hash(prefix || input), with the
+  // prefix absorbed only once here
+  Hash withPrefix(const string& prefix) const;
+
  private:
   int rows;
   int cols;
+  HashBackend backend;
+  SHA256 shaPrefix;
+  SHAKE128 shakePrefix;
+
+  // Counter mode, i.e. from the stream SHA256(input || 0) || SHA256(input ||
+  // 1) || ...
+  Matrix hashSHA256(const string& input);
+
+  // Uniform over Z_q: ceil(log2(q))-bit candidates from SHAKE128(input), those
+  // >= q are rejected
+  Matrix hashSHAKE128(const string& input);
 };
 
-#endif  // HASH_HPP
\ No newline at end of file
+#endif  // HASH_HPP
@@ -1,61 +1,178 @@
 #ifndef IBME_HPP
 #define IBME_HPP
 
+#include <atomic>
 #include <bitset>
 #include <cmath>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
 
+#include "BitVector.hpp"
+#include "Ciphertext.hpp"
+#include "DecryptionKey.hpp"
 #include "Hash.hpp"
+#include "KeyBlock.hpp"
 #include "MP12.hpp"
+#include "MatrixCache.hpp"
+#include "ParamSet.hpp"
+#include "PerturbationPool.hpp"
+#include "RevocationList.hpp"
+#include "ThreadPool.hpp"
+#include "Trapdoor.hpp"
 #include "Tree.hpp"
 #include "Utils.hpp"
 
-#define USER_NUM 4
-#define MESSAGE_LEN 12
-#define MODULUS 3329
-#define K ceil(log2(MODULUS))
-#define ROWS 96
-#define COLS ROWS* K
-#define SIGNATURE_LEN 3 * COLS* K
-#define N MESSAGE_LEN + SIGNATURE_LEN
-#define SIGMA MODULUS / COLS
-#define ALPHA 1 / (COLS * COLS)  // between 0 and 1
-#define NOISE_SIGMA ALPHA / sqrt(2 * M_PI)
+// Default parameter set, one of the named sets in ParamSet.hpp, e.g.
+// -DIBME_PARAMS=ToyParams. IBME instances take their dimensions from a
+// SchemeParams and only default to this set; the macros below describe it
+// for the code written against fixed dimensions.
+#ifndef IBME_PARAMS
+#define IBME_PARAMS DefaultParams
+#endif
+typedef IBME_PARAMS Params;
+
+#define USER_NUM (Params::users)  // default user capacity
+#define MESSAGE_LEN (Params::messageLen)
+#define MODULUS (Params::q)
+#define K (Params::k)
+#define ROWS (Params::n)
+#define COLS (Params::m)
+#define SIGNATURE_LEN (Params::signatureLen)
+#define N (Params::slots)
+#define SIGMA (Params::sigma)
+#define ALPHA (Params::alpha)  // between 0 and 1
+#define NOISE_SIGMA (Params::noiseSigma)
+#define CACHE_CAPACITY 64
+#define SLOT_CHUNK 512  // slots handled per batched SampleLeft
+
+class KeyUpdateScheduler;
 
 class IBME {
  private:
-  Matrix trapdoorA;
-  Matrix trapdoorA_prime;
+  friend class KeyUpdateScheduler;
+  // Dimensions of this instance
+  const SchemeParams params;
+  // Modulus, samplers and generators of this instance, installed on the
+  // calling thread by every public method. Declared first so that it
+  // outlives the pools sampling under it.
+  shared_ptr<CryptoContext> context;
+
+  Trapdoor trapdoorA;
+  Trapdoor trapdoorA_prime;
+  HashBackend hashBackend;
+  Hash hashId;       // H, for receiver identities and epochs
+  Hash hashSender;   // H1, for sender identities
+  Hash hashMessage;  // H2, for h_m
+  Hash hashNode;     // PRF for the node targets u1, keyed by a setup seed
+  MatrixCache cache;
+  // Offline randomness for Enc's signature and for SampleLeft in
+  // RKGen/KUpdGen, only present while precomputation is running
+  unique_ptr<PerturbationPool> signPool;
+  unique_ptr<PerturbationPool> sampleLeftPool;
+
+  // Identity and epoch derived matrices, built once and then served from
+  // the cache: F_id = B1 + H(id) * C1, F_t = B2 + H(t) * C2 and H(sender)
+  shared_ptr<const Matrix> receiverMatrix(int receiver_id);
+  shared_ptr<const Matrix> epochMatrix(int t);
+  shared_ptr<const Matrix> senderMatrix(int sender_id);
+
+  // Columns [first, first + count) of U as an n x count block
+  Matrix targetBlock(unsigned int first, unsigned int count) const;
+
+  // Targets of slots [first, first + SLOT_CHUNK) at node v for the receiver
+  // half (u1) or the update half (u2 = u - u1). u1 is the PRF output for
+  // (v, first), so nothing is stored per node; first is a multiple of
+  // SLOT_CHUNK and the last chunk is cut to the remaining slots.
+  Matrix nodeTargets(unsigned int v, unsigned int first, bool receiverHalf);
+
+  // Interactive key generation calls in progress, background work backs
+  // off while this is nonzero
+  atomic<int> interactive{0};
+
+  // SampleLeft with [A | M1] for the slot chunk starting at first of one
+  // node, checked against F and stored into out
+  void sampleNodeChunk(const TreeNode* node, bool receiverHalf,
+                       const Matrix& M1, const Matrix& F, unsigned int first,
+                       KeyBlock& out);
+
+  // SampleLeft with [A | M1] for all N slots of every node, targets u1 for
+  // the receiver half and u2 for the update half, checked against F
+  void sampleNodeKeys(const vector<TreeNode*>& nodes, bool receiverHalf,
+                      const Matrix& M1, const Matrix& F,
+                      vector<KeyBlock>& keys);
 
  public:
+  // A and A' in Hermite normal form [I | A], the identity is implicit and
+  // only the n x (2nk - n) part after it is stored
   Matrix A;
   Matrix A_prime;
   Matrix B1;
   Matrix B2;
   Matrix C1;
   Matrix C2;
-  vector<Matrix> u;
-  BinaryTree* tree;
-  set<pair<TreeNode*, int>> RL;
-
-  IBME();
-  Matrix SKGen(int sender_id);
-  vector<pair<TreeNode*, vector<Matrix>>> RKGen(int rcvr_id);
-  vector<pair<TreeNode*, vector<Matrix>>> KUpdGen(
-      const set<pair<TreeNode*, int>>& RL, int time);
-  vector<pair<Matrix, Matrix>> DKGen(
-      const vector<pair<TreeNode*, vector<Matrix>>>& rk_receiverid,
-      int receiver_id, const vector<pair<TreeNode*, vector<Matrix>>>& ku_t,
-      int t);
-  pair<vector<Matrix>, Matrix> Enc(const Matrix& ek_senderid, int sender_id,
-                                   int receiver_id,
-                                   const bitset<MESSAGE_LEN>& message,
-                                   int time);
-  string Dec(const vector<pair<Matrix, Matrix>>& dk_receiverid_t,
-             int receiver_id, int sender_id,
-             const pair<vector<Matrix>, Matrix>& ct);
+  // The N target vectors u_i as one n x N block stored column-major, i.e.
+  // as the N x n matrix U^T whose row i is u_i
+  Matrix U_t;
+  BinaryTree tree;
+  RevocationList RL;
+
+  // Set up the scheme for user IDs 0, ..., capacity - 1. Without a context,
+  // the instance gets its own one with a random seed; a given context is
+  // configured for the parameter set and may be shared with other instances
+  // of the same parameter set.
+  explicit IBME(unsigned int capacity = USER_NUM,
+                shared_ptr<CryptoContext> context = nullptr,
+                const SchemeParams& params = SchemeParams::of<Params>());
+
+  const SchemeParams& getParams() const;
+  CryptoContext& getContext() const;
+
+  unsigned int getCapacity() const;
+
+  // Whether an interactive SKGen or RKGen call is running
+  bool interactivePending() const;
+
+  // Precompute the derived matrices of every user and of epochs
+  // t, ..., t + epochs - 1. The cache grows to hold all of them, which is
+  // two matrices per user, so this is meant for capacities that fit memory.
+  void warmCache(int t, int epochs);
+
+  // Derived matrices cached so far
+  const MatrixCache& getCache() const;
+
+  // Start background threads that keep up to capacity perturbations ready
+  // for each kind of preimage, and stop them again
+  void startPrecomputation(size_t capacity, size_t threads = 1);
+  void stopPrecomputation();
+
+  Trapdoor SKGen(int sender_id);
+  // Issue keys for many senders at once, scheduled concurrently on the
+  // thread pool. latency_ms, if given, receives the time spent on each sender.
+  vector<Trapdoor> SKGenBatch(const vector<int>& sender_ids,
+                              vector<double>* latency_ms = nullptr);
+  // Keys of the path of the receiver, root first
+  NodeKeys RKGen(int rcvr_id);
+  // Keys of the cover of epoch time, in node index order
+  NodeKeys KUpdGen(const RevocationList& RL, int time);
+  // Match the receiver path against the update cover by node index. The
+  // blocks were checked when they were sampled, so this does no products
+  // and the returned key only references them.
+  DecryptionKey DKGen(const NodeKeys& rk_receiverid, int receiver_id,
+                      const NodeKeys& ku_t, int t);
+  // Check F_id e1 + F_t e2 = u for every slot of a decryption key
+  void checkDecryptionKey(const DecryptionKey& dk, int receiver_id, int t);
+  // message has params.messageLen bits, given as a string of '0' and '1'
+  // like the one Dec returns; the bitset form needs the default set's length
+  Ciphertext Enc(const Trapdoor& ek_senderid, int sender_id,
+                 int receiver_id, const string& message, int time);
+  Ciphertext Enc(const Trapdoor& ek_senderid, int sender_id,
+                 int receiver_id, const bitset<MESSAGE_LEN>& message,
+                 int time);
+  string Dec(const DecryptionKey& dk_receiverid_t, int receiver_id,
+             int sender_id, const Ciphertext& ct);
   void KRev(int user_id, int time);
 };
 
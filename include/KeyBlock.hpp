@@ -0,0 +1,63 @@
+#ifndef KEY_BLOCK_HPP
+#define KEY_BLOCK_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.hpp"
+
+// Preimages of all N slots of one tree node (a receiver key or a key update
+// for that node). Entries are stored as centered int16 residues in one
+// contiguous slot-major array, so slot i is the length entries starting at
+// slot(i) and a pass over the keys reads memory sequentially.
+class KeyBlock {
+ public:
+  // What a block was issued as. A receiver key is tagged with the receiver
+  // identity and a key update with its epoch, so DKGen can refuse keys
+  // issued for another receiver or epoch.
+  enum Purpose { UNTAGGED, RECEIVER_KEY, KEY_UPDATE };
+
+  KeyBlock();
+  KeyBlock(unsigned int slots, unsigned int length);
+
+  unsigned int getSlots() const;
+  unsigned int getLength() const;
+
+  void tag(Purpose purpose, int owner);
+  Purpose getPurpose() const;
+  // Receiver identity or epoch the block was issued for
+  int getOwner() const;
+
+  // View of the length entries of slot i
+  const int16_t* slot(unsigned int i) const;
+  int16_t* slot(unsigned int i);
+
+  // Entry r of slot i as a residue in [0, q)
+  BigInt get(unsigned int i, unsigned int r) const;
+
+  // Store the columns of E (length x count) as slots first, ..., first +
+  // count - 1
+  void setSlots(unsigned int first, const Matrix& E);
+
+  // Slot i as a length x 1 matrix of residues
+  Matrix getSlot(unsigned int i) const;
+
+  // Slots [first, first + count) as the columns of a length x count matrix
+  Matrix getSlotBlock(unsigned int first, unsigned int count) const;
+
+  // Decryption products of a receiver key block rk and an update block ku
+  // against c = [c0; c1; c2] (3 * length / 2 entries): for every slot i,
+  // out[i] = rk_i^T [c0; c1] + ku_i^T [c0; c2] mod q. This is one GEMV with
+  // the N x (3 * length / 2) packed key [rk_top + ku_top | rk_bot | ku_bot],
+  // evaluated on the fly over slot ranges on the thread pool.
+  static void innerProducts(const KeyBlock& rk, const KeyBlock& ku,
+                            const BigInt* c, BigInt* out);
+
+ private:
+  unsigned int slots, length;
+  Purpose purpose;
+  int owner;
+  vector<int16_t> data;
+};
+
+#endif  // KEY_BLOCK_HPP
@@ -0,0 +1,71 @@
+#ifndef KEY_UPDATE_SCHEDULER_HPP
+#define KEY_UPDATE_SCHEDULER_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "IB-ME.hpp"
+
+// Builds the key update of the next epoch ahead of time. Once the
+// revocation list for epoch t is final, prepare(t) snapshots its cover,
+// caches F_t and samples the update one (node, slot chunk) task at a time on
+// a pool of idle-priority threads. The work backs off while paused and while
+// IBME has an interactive SKGen/RKGen call running. At rollover publish(t)
+// hands out the prebuilt update, finishing any tasks that are left in the
+// foreground, or runs KUpdGen if the revocation list changed since.
+class KeyUpdateScheduler {
+ public:
+  typedef NodeKeys KeyUpdate;
+
+  explicit KeyUpdateScheduler(IBME& ibme, size_t threads = 1);
+  ~KeyUpdateScheduler();
+
+  KeyUpdateScheduler(const KeyUpdateScheduler&) = delete;
+  KeyUpdateScheduler& operator=(const KeyUpdateScheduler&) = delete;
+
+  // Start building the key update of epoch t, dropping any earlier job
+  void prepare(int t);
+
+  // Hold and continue the background work
+  void pause();
+  void resume();
+
+  // Whether the key update of epoch t is completely built
+  bool isReady(int t) const;
+
+  // The key update of epoch t, prebuilt if possible
+  shared_ptr<const KeyUpdate> publish(int t);
+
+  // Last published key update and its epoch, nullptr before the first
+  shared_ptr<const KeyUpdate> latest() const;
+  int latestEpoch() const;
+
+ private:
+  struct Job;
+
+  // Run tasks of job until none are left. Background runners wait while
+  // paused or preempted, the foreground runner of publish never does.
+  void run(Job& job, bool foreground);
+
+  // Wait until the background may take its next task; false if the job was
+  // dropped meanwhile
+  bool mayContinue(const Job& job);
+
+  IBME& ibme;
+  mutable mutex mtx;
+  condition_variable resumed;
+  bool paused;
+  shared_ptr<Job> job;
+  shared_ptr<const KeyUpdate> published;
+  int publishedEpoch;
+  size_t threads;
+
+  // Declared last so its workers are joined before the members they use are
+  // destroyed
+  ThreadPool pool;
+};
+
+#endif  // KEY_UPDATE_SCHEDULER_HPP
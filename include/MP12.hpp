@@ -8,21 +8,28 @@
 #include <utility>
 #include <vector>
 
+#include "CryptoContext.hpp"
+#include "GadgetSampler.hpp"
 #include "Matrix.hpp"
+#include "PerturbationPool.hpp"
+#include "ThreadPool.hpp"
+#include "Trapdoor.hpp"
 
 class MP12 {
+ public:
+  // How fGInverse answers each coordinate: DIRECT samples the gadget lattice
+  // digit by digit, ORACLE looks the residue up in the precomputed table
+  typedef CryptoContext::GInverseMethod GInverseMethod;
+  static const GInverseMethod DIRECT = CryptoContext::DIRECT;
+  static const GInverseMethod ORACLE = CryptoContext::ORACLE;
+
  private:
-  static Matrix* List;
-  // static unsigned int mean;
-  static double stddev;
-  static mt19937 rng;
-
-  int partition(int low, int high);
-  void quickSort(int low, int high);
-  unsigned int binarySearch(BigInt target);
+  // Write a random oracle table sample with residue u into x (k entries)
+  void oracle(BigInt u, BigInt* x);
   Matrix O(BigInt u);
   Matrix fGInverse(Matrix u);
-  void generateList(unsigned int q);
+  // G^-1 of every column of U, written into the nk x cols(U) matrix Z
+  void fGInverseBatch(const Matrix& U, Matrix& Z);
 
  public:
   static void testmp();
@@ -30,23 +37,59 @@ class MP12 {
   static void testfAwithoutV();
   static void testDelTrap();
 
+  // All state lives in the context of the calling thread. The first
+  // constructor checks that it is configured, the second configures it for
+  // q and stddev, replacing an earlier configuration.
   MP12();
   MP12(unsigned int q, double stddev);
 
   double getStddev();
 
+  // Select the G^-1 method, the table is only built once ORACLE is used
+  static void setGInverseMethod(GInverseMethod m);
+  static GInverseMethod getGInverseMethod();
+
+  // Write a sample x in Z^k with <g, x> = u mod q, using the selected method
+  static void gInverse(BigInt u, BigInt* x);
+  // Same with a precomputed perturbation p from gadgetPerturbation, always
+  // using the direct sampler
+  static void gInverse(BigInt u, const BigInt* p, BigInt* x);
+  // Write the target-independent perturbation of a gadget sample (k entries)
+  static void gadgetPerturbation(BigInt* p);
+
   // Function to generate a trapdoor, A size n x 2nk
   static pair<Matrix, Matrix> trapGen(unsigned int n);
+  // Same in Hermite normal form, A = [I | A_bar | G - [I | A_bar] R]. Only
+  // the part after the identity is returned, n x (2nk - n); use
+  // Matrix::multiplyHNF and Matrix::transposeMultiplyHNF for products.
+  static pair<Matrix, Matrix> trapGenHNF(unsigned int n);
   static Matrix fAInverse(Matrix A, Matrix T_A, Matrix u);
-  static Matrix fAInversewithoutVariance(Matrix A, Matrix T_A, Matrix u);
+  // The preimage only depends on T_A, A is kept for the callers
+  static Matrix fAInversewithoutVariance(const Matrix& /* A */,
+                                         const Matrix& T_A, const Matrix& u);
+  // Preimages of all columns of U at once: out = [T_A; I] * G^-1(U), where
+  // out is preallocated with (rows(T_A) + cols(T_A)) x cols(U) entries
+  static void fAInverseBatch(const Matrix& T_A, const Matrix& U, Matrix& out);
 
   // Function to delegate a trapdoor, A size n x m, A1 size n x nk
   static pair<Matrix, Matrix> delTrap(const Matrix& A, const Matrix& T_A,
                                       const Matrix& A1, double stddev);
+  // Same delegation from a compact trapdoor, the result is compacted too
+  static pair<Matrix, Trapdoor> delTrap(const Matrix& A, const Trapdoor& T_A,
+                                        const Matrix& A1);
 
-  // SampleLeft
+  // SampleLeft, taking e2 and the gadget perturbations from pool if one is
+  // given and not empty
   static Matrix SampleLeft(const Matrix& A, const Matrix& M1,
-                           const Matrix& trapdoorA, const Matrix& u);
+                           const Trapdoor& trapdoorA, const Matrix& u,
+                           PerturbationPool* pool = nullptr);
+  // SampleLeft for every column of U at once, column j of the result is
+  // the preimage of column j of U. A is in Hermite normal form, i.e. the
+  // n x (2nk - n) part after the identity as returned by trapGenHNF, and
+  // the shapes of M1, U, the trapdoor and the pool are checked against it.
+  static Matrix SampleLeftBatch(const Matrix& A, const Matrix& M1,
+                                const Trapdoor& trapdoorA, const Matrix& U,
+                                PerturbationPool* pool = nullptr);
 };
 
 #endif  // MP12_HPP
@@ -1,20 +1,19 @@
 #ifndef MATRIX_HPP
 #define MATRIX_HPP
 
+#include <climits>
 #include <ctime>
 #include <random>
 #include <vector>
 
+#include "CryptoContext.hpp"
 #include "DiscreteGaussianSampler.hpp"
 #include "DiscreteUniformSampler.hpp"
 
 class Matrix {
  private:
-  vector<vector<BigInt>> data;
+  vector<BigInt> data;  // row-major, rows * cols entries
   unsigned int rows, cols;
-  static unsigned int k;
-  static BigInt modulus;
-  static mt19937 rand_generator;
 
  public:
   // Default Constructor
@@ -28,10 +27,10 @@ class Matrix {
   unsigned int getCols() const;
   static unsigned int getK();
 
-  // Function to set the global modulus
+  // Function to set the modulus of the current CryptoContext
   static void setModulus(const BigInt& mod);
 
-  // Function to get the global modulus
+  // Function to get the modulus of the current CryptoContext
   static BigInt getModulus();
 
   // Method to swap two columns
@@ -40,12 +39,19 @@ class Matrix {
   // get a column from Matrix
   Matrix getColVector(unsigned int col) const;
 
+  // Function to get the columns [first, first + count) as a matrix
+  Matrix getColBlock(unsigned int first, unsigned int count) const;
+
   // Function to set a value in the matrix
   void set(unsigned int r, unsigned int c, const BigInt& value);
 
   // Function to get a value from the matrix
   BigInt get(unsigned int r, unsigned int c) const;
 
+  // Function to get a pointer to the storage of a row
+  BigInt* rowData(unsigned int r);
+  const BigInt* rowData(unsigned int r) const;
+
   // Function to add two matrices
   Matrix operator+(const Matrix& other) const;
 
@@ -55,6 +61,21 @@ class Matrix {
   // Function to multiply two matrices
   Matrix operator*(const Matrix& other) const;
 
+  // Function to multiply A * B into rows [rowOffset, rowOffset + A.rows) of a
+  // preallocated matrix, with a cache-blocked kernel. Only rows
+  // [firstRow, lastRow) of A are computed, so bands can run on separate threads.
+  static void multiplyInto(const Matrix& A, const Matrix& B, Matrix& out,
+                           unsigned int rowOffset = 0,
+                           unsigned int firstRow = 0,
+                           unsigned int lastRow = UINT_MAX);
+
+  // Function to multiply a matrix in Hermite normal form [I | tail] by x.
+  // The identity block is implicit, only tail is stored and multiplied.
+  static Matrix multiplyHNF(const Matrix& tail, const Matrix& x);
+
+  // Function to multiply the transpose [I | tail]^T by s
+  static Matrix transposeMultiplyHNF(const Matrix& tail, const Matrix& s);
+
   // Function to check if two matrices are equal
   bool operator==(const Matrix& other) const;
 
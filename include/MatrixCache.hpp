@@ -0,0 +1,46 @@
+#ifndef MATRIX_CACHE_HPP
+#define MATRIX_CACHE_HPP
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "Matrix.hpp"
+
+// Bounded, thread-safe LRU cache for matrices derived from an identity or an
+// epoch, e.g. F_id = B1 + H(id) * C1. Entries are immutable once built and are
+// handed out as shared pointers, so an eviction never invalidates a caller.
+class MatrixCache {
+ public:
+  enum Kind { RECEIVER, EPOCH, SENDER };
+
+  MatrixCache(size_t capacity = 64);
+
+  // Return the cached matrix for (kind, id), calling build on a miss
+  shared_ptr<const Matrix> get(Kind kind, int id,
+                               const function<Matrix()>& build);
+
+  // Check whether (kind, id) is currently cached
+  bool contains(Kind kind, int id) const;
+
+  // Raise the capacity to at least capacity entries, it never shrinks
+  void reserve(size_t capacity);
+
+  void clear();
+  size_t size() const;
+  size_t getCapacity() const;
+
+ private:
+  typedef pair<int, int> Key;
+  typedef list<pair<Key, shared_ptr<const Matrix>>> Entries;
+
+  size_t capacity;
+  mutable mutex mtx;
+  Entries entries;  // most recently used first
+  map<Key, Entries::iterator> index;
+};
+
+#endif  // MATRIX_CACHE_HPP
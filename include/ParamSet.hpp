@@ -0,0 +1,120 @@
+#ifndef PARAM_SET_HPP
+#define PARAM_SET_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+#include "DataType.hpp"
+
+// ceil(log2(x)) for x >= 1, usable in constant expressions
+constexpr unsigned int ceilLog2(BigInt x) {
+  unsigned int bits = 0;
+  while ((BigInt(1) << bits) < x) {
+    bits++;
+  }
+  return bits;
+}
+
+// Dimensions of one IB-ME instance, all known at compile time
+template <unsigned int Rows, BigInt Modulus, unsigned int MessageLen,
+          unsigned int Users>
+struct ParamSet {
+  static constexpr unsigned int n = Rows;
+  static constexpr BigInt q = Modulus;
+  static constexpr unsigned int k = ceilLog2(Modulus);
+  static constexpr unsigned int m = Rows * k;
+  static constexpr unsigned int messageLen = MessageLen;
+  static constexpr unsigned int signatureLen = 3 * m * k;
+  static constexpr unsigned int slots = messageLen + signatureLen;
+  static constexpr unsigned int users = Users;  // default user capacity
+
+  // (q / n) * k with integer division, the value the former SIGMA macro
+  // MODULUS / COLS expanded to, kept so sample widths do not change
+  static constexpr double sigma = static_cast<double>(Modulus / Rows) * k;
+  static constexpr double alpha = 1.0 / (static_cast<double>(m) * m);
+  static constexpr double noiseSigma = alpha / 2.5066282746310002;  // sqrt(2pi)
+
+  static_assert(Modulus >= 2 && Modulus < 65536,
+                "keys and trapdoors are stored as centered 16-bit residues");
+};
+
+// The dimensions of a ParamSet as runtime values. IBME takes one of these,
+// so instances of different sets can run side by side in one binary; the
+// compile-time sets only matter to the kernels dispatched below.
+struct SchemeParams {
+  unsigned int n;
+  BigInt q;
+  unsigned int k;
+  unsigned int m;
+  unsigned int messageLen;
+  unsigned int signatureLen;
+  unsigned int slots;
+  unsigned int users;
+  double sigma;
+  double alpha;
+  double noiseSigma;
+
+  template <class P>
+  static SchemeParams of() {
+    return SchemeParams{P::n,     P::q,          P::k,
+                        P::m,     P::messageLen, P::signatureLen,
+                        P::slots, P::users,      P::sigma,
+                        P::alpha, P::noiseSigma};
+  }
+};
+
+// Named parameter sets
+typedef ParamSet<8, 3329, 12, 4> ToyParams;        // functional checks
+typedef ParamSet<96, 3329, 12, 4> DefaultParams;   // the benchmarked set
+typedef ParamSet<128, 7681, 12, 4> LargeParams;
+
+template <class... Sets>
+struct ParamSetList {};
+
+// Every set the kernels below are instantiated for
+typedef ParamSetList<ToyParams, DefaultParams, LargeParams> NamedParamSets;
+
+// Call kernel(q) with the modulus as integral_constant<BigInt, q> when q is
+// the modulus of a named set, so reductions by it compile to multiplications,
+// and with the runtime value otherwise
+template <class Kernel>
+void dispatchModulus(ParamSetList<>, BigInt q, Kernel& kernel) {
+  kernel(q);
+}
+
+template <class P, class... Rest, class Kernel>
+void dispatchModulus(ParamSetList<P, Rest...>, BigInt q, Kernel& kernel) {
+  if (q == P::q) {
+    kernel(integral_constant<BigInt, P::q>());
+  } else {
+    dispatchModulus(ParamSetList<Rest...>(), q, kernel);
+  }
+}
+
+template <class Kernel>
+void withModulus(BigInt q, Kernel&& kernel) {
+  dispatchModulus(NamedParamSets(), q, kernel);
+}
+
+// Same for the gadget length k, so loops over the digits are unrolled
+template <class Kernel>
+void dispatchGadgetLength(ParamSetList<>, unsigned int k, Kernel& kernel) {
+  kernel(k);
+}
+
+template <class P, class... Rest, class Kernel>
+void dispatchGadgetLength(ParamSetList<P, Rest...>, unsigned int k,
+                          Kernel& kernel) {
+  if (k == P::k) {
+    kernel(integral_constant<unsigned int, P::k>());
+  } else {
+    dispatchGadgetLength(ParamSetList<Rest...>(), k, kernel);
+  }
+}
+
+template <class Kernel>
+void withGadgetLength(unsigned int k, Kernel&& kernel) {
+  dispatchGadgetLength(NamedParamSets(), k, kernel);
+}
+
+#endif  // PARAM_SET_HPP
@@ -0,0 +1,53 @@
+#ifndef PERTURBATION_POOL_HPP
+#define PERTURBATION_POOL_HPP
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.hpp"
+#include "DiscreteGaussianSampler.hpp"
+
+// Offline half of preimage sampling. Background threads keep a bounded
+// lock-free queue filled with target-independent randomness, so the request
+// path only runs the target-dependent half. An item holds n gadget
+// perturbations of k entries each (one G^-1 column, see
+// GadgetSampler::perturb), followed by extra Gaussian entries such as the e2
+// half of SampleLeft. When the pool runs dry, items are computed inline.
+// Producers sample under the CryptoContext the pool was created in, which
+// has to outlive the pool.
+class PerturbationPool {
+ public:
+  PerturbationPool(unsigned int n, unsigned int extra, double extraStddev,
+                   size_t capacity, size_t threads = 1);
+  ~PerturbationPool();
+
+  PerturbationPool(const PerturbationPool&) = delete;
+  PerturbationPool& operator=(const PerturbationPool&) = delete;
+
+  // Pop a precomputed item, returns false if the pool is empty
+  bool tryTake(vector<BigInt>& item);
+
+  // Pop a precomputed item or compute one inline
+  void take(vector<BigInt>& item);
+
+  // Number of items currently waiting in the pool
+  size_t available() const;
+
+  // Length n * k of the gadget part and of the extra part of an item
+  unsigned int getGadgetLength() const;
+  unsigned int getExtraLength() const;
+
+ private:
+  void generate(vector<BigInt>& item);
+  void produce();
+
+  unsigned int n, k, extra;
+  DiscreteGaussianSampler extraSampler;
+  BoundedQueue<vector<BigInt>> queue;
+  atomic<bool> stopping;
+  CryptoContext* context;
+  vector<thread> producers;
+};
+
+#endif  // PERTURBATION_POOL_HPP
@@ -0,0 +1,75 @@
+#ifndef REVOCATION_LIST_HPP
+#define REVOCATION_LIST_HPP
+
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Revocation list over the leaves of a heap-ordered BinaryTree, indexed by
+// the epoch a revocation takes effect. It keeps the complete-subtree cover
+// (KUNodes) of the leaves that are not revoked at its current epoch up to
+// date as revocations are applied, at O(log n) per revocation, so planning
+// the key updates of an epoch does not rebuild anything.
+//
+// Both the set of nodes on a revoked path and the cover are kept as one
+// bitmap per tree level.
+class RevocationList {
+ public:
+  RevocationList();
+  explicit RevocationList(unsigned int capacity);
+
+  unsigned int getCapacity() const;
+
+  // Revoke users from epoch time on. A user that is already revoked keeps
+  // the earlier of the two epochs.
+  void revoke(unsigned int user, int time);
+  void revoke(const vector<unsigned int>& users, int time);
+
+  // Drop the entries of users, e.g. once their identities are retired
+  void expire(const vector<unsigned int>& users);
+
+  // Epoch from which user is revoked, INT_MAX if never
+  int revokedAt(unsigned int user) const;
+
+  // Number of users revoked at epoch t
+  size_t count(int t) const;
+
+  // Heap indices of the cover of the users not revoked at epoch t, in index
+  // order. Moving between epochs applies or undoes only the entries of the
+  // epochs in between.
+  vector<unsigned int> cover(int t) const;
+
+ private:
+  typedef vector<vector<uint64_t>> LevelBitmap;
+
+  unsigned int capacity;
+  vector<int> since;                         // per user, INT_MAX if never
+  map<int, vector<unsigned int>> schedule;   // epoch -> users revoked then
+
+  mutable mutex mtx;
+  mutable int current;        // epoch the bitmaps describe
+  mutable size_t active;      // users revoked at current
+  mutable LevelBitmap onPath; // nodes with a revoked leaf below them
+  mutable LevelBitmap covered;
+  mutable size_t coverSize;
+
+  static bool test(const LevelBitmap& bits, unsigned int v);
+  static void assign(LevelBitmap& bits, unsigned int v, bool value);
+
+  // Recompute whether node v belongs to the cover
+  void updateCover(unsigned int v) const;
+
+  // Mark or unmark a leaf as revoked and fix the paths and the cover above it
+  void setLeaf(unsigned int user, bool revoked) const;
+
+  // Bring the bitmaps to epoch t
+  void moveTo(int t) const;
+
+  void unschedule(unsigned int user);
+};
+
+#endif  // REVOCATION_LIST_HPP
@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CryptoContext.hpp"
+#include "DataType.hpp"
+
+// Fixed-size work-stealing pool shared by the key generation code. Each
+// worker owns a queue; jobs spawned from a worker go to its own queue and
+// idle workers steal from the others. parallelFor lets the calling thread
+// take part in the loop, so it can be nested inside a task running on the
+// same pool without deadlocking. Every task runs under the CryptoContext of
+// the thread that queued it.
+class ThreadPool {
+ public:
+  // Helper threads of a background pool run at idle priority, so they only
+  // get CPU time nothing else wants
+  explicit ThreadPool(size_t threads = thread::hardware_concurrency(),
+                      bool background = false);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Pool for parallel loops of the calling thread: the pool it is a worker
+  // of, so nested loops stay on a background pool, or else the pool shared
+  // by the whole process, sized to the number of cores
+  static ThreadPool& instance();
+
+  size_t size() const;
+
+  // Queue a task and return a future for its result
+  template <typename F>
+  auto submit(F&& task) -> future<decltype(task())> {
+    typedef decltype(task()) R;
+    auto job = make_shared<packaged_task<R()>>(std::forward<F>(task));
+    future<R> result = job->get_future();
+    enqueue([job]() { (*job)(); });
+    return result;
+  }
+
+  // Run body(i) for every i in [begin, end), in chunks of grain iterations.
+  // Returns once all iterations are done and rethrows the first exception.
+  void parallelFor(size_t begin, size_t end,
+                   const function<void(size_t)>& body, size_t grain = 1);
+
+ private:
+  struct WorkQueue {
+    mutex mtx;
+    deque<function<void()>> jobs;
+  };
+
+  void enqueue(function<void()> job);
+  bool takeJob(size_t self, function<void()>& job);
+  void workerLoop(size_t self, bool background);
+
+  vector<unique_ptr<WorkQueue>> queues;  // one per worker
+  vector<thread> workers;
+  atomic<size_t> pending;  // jobs waiting in any queue
+  atomic<size_t> nextQueue;
+  mutex sleepMtx;
+  condition_variable ready;
+  bool stopping;
+};
+
+#endif  // THREAD_POOL_HPP
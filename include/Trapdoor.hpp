@@ -0,0 +1,61 @@
+#ifndef TRAPDOOR_HPP
+#define TRAPDOOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.hpp"
+
+class PerturbationPool;
+
+// MP12 trapdoor R for A = [A0 | G - A0 R], with R of size m x nk. R is kept
+// row-major as centered int16 values instead of a Matrix of residues, and a
+// preimage [R z; z] is computed directly from it without materializing the
+// identity block or the concatenation [R; I].
+class Trapdoor {
+ public:
+  Trapdoor();
+
+  // Compact a trapdoor given as a matrix of residues mod q
+  explicit Trapdoor(const Matrix& R);
+
+  // Number of rows m and columns nk of R
+  unsigned int getRows() const;
+  unsigned int getCols() const;
+
+  // Length m + nk of a preimage
+  unsigned int getPreimageRows() const;
+
+  // R as a matrix of residues mod q
+  Matrix toMatrix() const;
+
+  // Preimages x = [R z; z] of all columns of U with z = G^-1(U), written to
+  // out, which must be preallocated with getPreimageRows() x cols(U) entries.
+  // If a pool is given, columns use its precomputed gadget perturbations
+  // while it has any left.
+  void preimage(const Matrix& U, Matrix& out,
+                PerturbationPool* pool = nullptr) const;
+  Matrix preimage(const Matrix& U, PerturbationPool* pool = nullptr) const;
+
+  // Same with the gadget perturbations of each column given explicitly,
+  // perturbations[j] points to the nk entries of a PerturbationPool item
+  void preimage(const Matrix& U, Matrix& out,
+                const BigInt* const* perturbations) const;
+
+  // Preimage of a single column u with the gadget perturbations p
+  Matrix preimage(const Matrix& u, const BigInt* p) const;
+
+ private:
+  void checkShapes(const Matrix& U, const Matrix& out) const;
+  // Write column j of z = G^-1(U) into the nk x width row-major buffer z
+  void sampleColumn(const Matrix& U, unsigned int j, const BigInt* p,
+                    int32_t* z, unsigned int width) const;
+  // Write [R z; z] mod q into out
+  void combine(const vector<int32_t>& z, unsigned int width,
+               Matrix& out) const;
+
+  unsigned int rows, cols;
+  vector<int16_t> R;  // centered entries in (-q / 2, q / 2]
+};
+
+#endif  // TRAPDOOR_HPP
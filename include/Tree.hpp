@@ -9,40 +9,58 @@
 #include <vector>
 
 #include "Matrix.hpp"
+#include "RevocationList.hpp"
 
+// A node only records its heap index. Its targets u1 and u2 = u - u1 are
+// not stored but derived from the index whenever they are needed.
 class TreeNode {
  public:
-  vector<Matrix> u1;  // Vector to store u_i_N_1
-  vector<Matrix> u2;  // Vector to store u_i_N_2
-  TreeNode* left;
-  TreeNode* right;
-  TreeNode* parent;
+  unsigned int index;
 
   // Constructor to initialize the node with default values
   TreeNode();
 };
 
+// Complete binary tree with one leaf per user, stored implicitly in heap
+// order: node 0 is the root, the children of node v are 2v + 1 and 2v + 2
+// and leaf i is node capacity - 1 + i. Every internal node has two
+// children, so there are 2 * capacity - 1 nodes. The TreeNode payloads live
+// in one array indexed the same way and are never reallocated.
 class BinaryTree {
  private:
-  // Helper function for findithLeaf
-  TreeNode* findLeafHelper(TreeNode* node, int& currentIndex, int targetIndex);
+  unsigned int capacity;
+  vector<TreeNode> nodes;
 
  public:
-  TreeNode* root;
-
   BinaryTree();
-  BinaryTree(int leaves);
+  explicit BinaryTree(unsigned int capacity);
+
+  // Number of leaves and of nodes
+  unsigned int getCapacity() const;
+  unsigned int size() const;
+
+  // Heap index arithmetic
+  static unsigned int parent(unsigned int v) { return (v - 1) / 2; }
+  static unsigned int left(unsigned int v) { return 2 * v + 1; }
+  static unsigned int right(unsigned int v) { return 2 * v + 2; }
+  bool isLeaf(unsigned int v) const { return v + 1 >= capacity; }
+  unsigned int leafIndex(unsigned int i) const { return capacity - 1 + i; }
 
-  TreeNode* initializeTree(int leaves);
+  // Payload of node v, and the index of a payload
+  TreeNode* node(unsigned int v);
+  unsigned int indexOf(const TreeNode* node) const;
 
   // Find the i-th leaf node
   TreeNode* findithLeaf(int i);
 
-  set<TreeNode*> path(TreeNode* v);
+  // Nodes from the root down to v
+  vector<TreeNode*> path(TreeNode* v);
+  vector<unsigned int> pathIndices(unsigned int v) const;
 
-  set<TreeNode*> KUNodes(const set<pair<TreeNode*, int>>& RL, int t);
+  // Cover of the leaves not revoked at time t, in index order
+  vector<TreeNode*> KUNodes(const RevocationList& RL, int t);
 
   void print();
 };
 
-#endif  // TREE_HPP
\ No newline at end of file
+#endif  // TREE_HPP
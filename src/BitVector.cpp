@@ -0,0 +1,108 @@
+#include "BitVector.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Reverse the order of the low k bits of v: swap halves, then quarters, and
+// so on down to single bits, and drop the 64 - k bits that moved to the bottom
+static uint64_t reverseBits(uint64_t v, unsigned int k) {
+  v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+  v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+  v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  v = ((v >> 8) & 0x00FF00FF00FF00FFULL) | ((v & 0x00FF00FF00FF00FFULL) << 8);
+  v = ((v >> 16) & 0x0000FFFF0000FFFFULL) |
+      ((v & 0x0000FFFF0000FFFFULL) << 16);
+  v = (v >> 32) | (v << 32);
+  return v >> (64 - k);
+}
+
+BitVector::BitVector() : bits(0) {}
+
+BitVector::BitVector(size_t bits) : bits(bits), words((bits + 63) / 64) {}
+
+size_t BitVector::size() const { return bits; }
+
+unsigned int BitVector::get(size_t i) const {
+  return (words[i >> 6] >> (i & 63)) & 1;
+}
+
+void BitVector::set(size_t i, unsigned int bit) {
+  uint64_t mask = uint64_t(1) << (i & 63);
+  words[i >> 6] = (words[i >> 6] & ~mask) | (uint64_t(bit & 1) << (i & 63));
+}
+
+uint64_t BitVector::field(size_t p, unsigned int k) const {
+  unsigned int shift = p & 63;
+  uint64_t v = words[p >> 6] >> shift;
+  if (shift + k > 64) {
+    v |= words[(p >> 6) + 1] << (64 - shift);
+  }
+  return k == 64 ? v : v & ((uint64_t(1) << k) - 1);
+}
+
+void BitVector::packCoefficients(size_t offset, const BigInt* values,
+                                 size_t count, unsigned int k) {
+  if (k == 0 || k > 63 || offset + count * k > bits) {
+    throw out_of_range("BitVector: coefficients do not fit");
+  }
+  const uint64_t mask = (uint64_t(1) << k) - 1;
+  for (size_t i = 0; i < count; i++) {
+    // The first bit of the field is the most significant bit of the value
+    uint64_t v = reverseBits(static_cast<uint64_t>(values[i]) & mask, k);
+    size_t p = offset + i * k;
+    unsigned int shift = p & 63;
+    uint64_t* w = &words[p >> 6];
+    w[0] = (w[0] & ~(mask << shift)) | (v << shift);
+    if (shift + k > 64) {
+      unsigned int spill = 64 - shift;
+      w[1] = (w[1] & ~(mask >> spill)) | (v >> spill);
+    }
+  }
+}
+
+void BitVector::unpackCoefficients(size_t offset, BigInt* values,
+                                   size_t count, unsigned int k) const {
+  if (k == 0 || k > 63 || offset + count * k > bits) {
+    throw out_of_range("BitVector: coefficients out of range");
+  }
+  for (size_t i = 0; i < count; i++) {
+    values[i] = static_cast<BigInt>(reverseBits(field(offset + i * k, k), k));
+  }
+}
+
+void BitVector::decodeSlots(size_t offset, const BigInt* w, size_t count,
+                            BigInt q) {
+  if (offset + count > bits) {
+    throw out_of_range("BitVector: slots out of range");
+  }
+  // the encoder adds q / 2 for a 1 bit
+  const BigInt half = q / 2;
+  const BigInt quarter = q / 4;
+  // Gather the bits of one word branchlessly and store it with one merge
+  size_t i = 0;
+  while (i < count) {
+    size_t p = offset + i;
+    unsigned int shift = p & 63;
+    size_t n = min<size_t>(64 - shift, count - i);
+    uint64_t word = 0;
+    for (size_t j = 0; j < n; j++) {
+      BigInt d = w[i + j] - half;
+      word |= uint64_t((d < 0 ? -d : d) < quarter) << j;
+    }
+    uint64_t mask = (n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1)
+                    << shift;
+    words[p >> 6] = (words[p >> 6] & ~mask) | (word << shift);
+    i += n;
+  }
+}
+
+string BitVector::toString(size_t first, size_t count) const {
+  if (first + count > bits) {
+    throw out_of_range("BitVector: bits out of range");
+  }
+  string out(count, '0');
+  for (size_t i = 0; i < count; i++) {
+    out[i] = '0' + get(first + i);
+  }
+  return out;
+}
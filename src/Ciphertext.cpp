@@ -0,0 +1,37 @@
+#include "Ciphertext.hpp"
+
+#include <algorithm>
+
+Ciphertext::Ciphertext() {}
+
+Ciphertext::Ciphertext(unsigned int slots, unsigned int length)
+    : c1Data(slots), c2Data(length) {}
+
+unsigned int Ciphertext::getSlots() const { return c1Data.size(); }
+
+unsigned int Ciphertext::getLength() const { return c2Data.size(); }
+
+BigInt* Ciphertext::c1() { return c1Data.data(); }
+
+const BigInt* Ciphertext::c1() const { return c1Data.data(); }
+
+BigInt* Ciphertext::c2() { return c2Data.data(); }
+
+const BigInt* Ciphertext::c2() const { return c2Data.data(); }
+
+Matrix Ciphertext::getC1(unsigned int i) const {
+  if (i >= c1Data.size()) {
+    throw out_of_range("Ciphertext: slot out of range");
+  }
+  Matrix out(1, 1);
+  out.rowData(0)[0] = c1Data[i];
+  return out;
+}
+
+Matrix Ciphertext::getC2() const {
+  Matrix out(c2Data.size(), 1);
+  if (!c2Data.empty()) {
+    copy(c2Data.begin(), c2Data.end(), out.rowData(0));
+  }
+  return out;
+}
@@ -0,0 +1,192 @@
+#include "CryptoContext.hpp"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+#include "DiscreteGaussianSampler.hpp"
+#include "GadgetSampler.hpp"
+
+thread_local CryptoContext* CryptoContext::active = nullptr;
+atomic<uint64_t> CryptoContext::nextId(1);
+
+// Generator for one stream of a seed
+static mt19937 streamGenerator(uint64_t seed, uint64_t stream) {
+  seed_seq sequence{static_cast<uint32_t>(seed),
+                    static_cast<uint32_t>(seed >> 32),
+                    static_cast<uint32_t>(stream),
+                    static_cast<uint32_t>(stream >> 32)};
+  return mt19937(sequence);
+}
+
+static uint64_t randomSeed() {
+  random_device device;
+  return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+CryptoContext::Scope::Scope(CryptoContext& context) : previous(active) {
+  active = &context;
+}
+
+CryptoContext::Scope::Scope(CryptoContext* context) : previous(active) {
+  active = context;
+}
+
+CryptoContext::Scope::~Scope() { active = previous; }
+
+CryptoContext::CryptoContext() : CryptoContext(randomSeed()) {}
+
+CryptoContext::CryptoContext(uint64_t seed)
+    : id(nextId++),
+      seed(seed),
+      creator(this_thread::get_id()),
+      creatorGenerator(streamGenerator(seed, 0)),
+      streams(0),
+      modulus(0),
+      k(0),
+      stddev(0),
+      method(DIRECT),
+      table(nullptr) {}
+
+CryptoContext::CryptoContext(BigInt q, double stddev)
+    : CryptoContext(q, stddev, randomSeed()) {}
+
+CryptoContext::CryptoContext(BigInt q, double stddev, uint64_t seed)
+    : CryptoContext(seed) {
+  configure(q, stddev);
+}
+
+CryptoContext::~CryptoContext() = default;
+
+CryptoContext& CryptoContext::processDefault() {
+  static CryptoContext context;
+  return context;
+}
+
+void CryptoContext::setModulus(BigInt q) {
+  if (q == modulus) {
+    return;
+  }
+  modulus = q;
+  k = ceil(log2(q));
+  gadget.reset();
+  table.store(nullptr);
+  tableStorage.reset();
+}
+
+void CryptoContext::configure(BigInt q, double stddev) {
+  if (q == modulus && stddev == this->stddev && gadget != nullptr) {
+    return;
+  }
+  setModulus(q);
+  this->stddev = stddev;
+  gadget.reset(new GadgetSampler(q, stddev));
+  table.store(nullptr);
+  tableStorage.reset();
+}
+
+const GadgetSampler& CryptoContext::getGadget() const {
+  if (gadget == nullptr) {
+    throw invalid_argument("CryptoContext: gadget sampler is not configured");
+  }
+  return *gadget;
+}
+
+const CryptoContext::OracleTable& CryptoContext::getOracleTable() {
+  const OracleTable* built = table.load(memory_order_acquire);
+  if (built == nullptr) {
+    lock_guard<mutex> lock(tableMtx);
+    if (table.load() == nullptr) {
+      buildOracleTable();
+    }
+    built = table.load();
+  }
+  return *built;
+}
+
+// Function to draw the q * k oracle samples and bucket them by residue
+void CryptoContext::buildOracleTable() {
+  if (modulus == 0) {
+    throw invalid_argument("CryptoContext: modulus is not set");
+  }
+  Scope scope(*this);
+  unsigned int q = modulus;
+  unsigned int count = q * k;
+  unique_ptr<OracleTable> built(new OracleTable());
+  built->k = k;
+
+  // Draw the samples column by column and bucket them by residue
+  DiscreteGaussianSampler sampler(stddev, q);
+  vector<BigInt> X(static_cast<size_t>(count) * k);
+  vector<unsigned int> residues(count);
+  vector<unsigned int> offsets(q + 1, 0);
+  for (unsigned int j = 0; j < count; j++) {
+    BigInt u = 0;
+    for (unsigned int i = 0; i < k; i++) {
+      BigInt x = (sampler.GenerateInteger() % q + q) % q;
+      X[static_cast<size_t>(j) * k + i] = x;
+      u = (u + (x << i)) % q;
+    }
+    residues[j] = u;
+    offsets[u + 1]++;
+  }
+
+  // Counting sort: prefix sums give where each residue's group starts
+  for (unsigned int u = 0; u < q; u++) {
+    offsets[u + 1] += offsets[u];
+  }
+  built->samples.resize(X.size());
+  vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+  for (unsigned int j = 0; j < count; j++) {
+    size_t dst = static_cast<size_t>(next[residues[j]]++) * k;
+    copy(X.begin() + static_cast<size_t>(j) * k,
+         X.begin() + static_cast<size_t>(j + 1) * k,
+         built->samples.begin() + dst);
+  }
+  built->offsets = offsets;
+
+  tableStorage = std::move(built);
+  table.store(tableStorage.get(), memory_order_release);
+}
+
+void CryptoContext::restart(uint64_t seed) {
+  if (this_thread::get_id() != creator) {
+    throw logic_error("CryptoContext: only the creator thread may restart");
+  }
+  creatorGenerator = streamGenerator(seed, 0);
+}
+
+mt19937& CryptoContext::rng() {
+  // The creator keeps its stream in the context, so switching contexts in
+  // between neither restarts nor skips it
+  if (this_thread::get_id() == creator) {
+    return creatorGenerator;
+  }
+  // Other threads keep the generators of the last few contexts they used,
+  // so alternating between instances resumes each stream instead of seeding
+  // a new one. Only a context that was evicted gets a fresh stream.
+  struct Cached {
+    uint64_t owner = 0;
+    uint64_t used = 0;
+    mt19937 generator;
+  };
+  thread_local array<Cached, 4> cached;
+  thread_local uint64_t uses = 0;
+  // The entry of this context, or else the least recently used one
+  Cached* entry = &cached[0];
+  for (Cached& c : cached) {
+    if (c.owner == id) {
+      entry = &c;
+      break;
+    }
+    if (c.used < entry->used) {
+      entry = &c;
+    }
+  }
+  if (entry->owner != id) {
+    entry->owner = id;
+    entry->generator = streamGenerator(seed, ++streams);
+  }
+  entry->used = ++uses;
+  return entry->generator;
+}
@@ -0,0 +1,34 @@
+#include "DecryptionKey.hpp"
+
+#include <stdexcept>
+
+DecryptionKey::DecryptionKey() : node(0) {}
+
+DecryptionKey::DecryptionKey(unsigned int node,
+                             shared_ptr<const KeyBlock> receiverKey,
+                             shared_ptr<const KeyBlock> keyUpdate)
+    : node(node),
+      receiverKey(std::move(receiverKey)),
+      keyUpdate(std::move(keyUpdate)) {
+  if (!this->receiverKey || !this->keyUpdate) {
+    throw invalid_argument("DecryptionKey: missing key block");
+  }
+}
+
+bool DecryptionKey::empty() const { return !receiverKey; }
+
+unsigned int DecryptionKey::getNode() const { return node; }
+
+const KeyBlock& DecryptionKey::getReceiverKey() const {
+  if (empty()) {
+    throw logic_error("DecryptionKey: the key is empty");
+  }
+  return *receiverKey;
+}
+
+const KeyBlock& DecryptionKey::getKeyUpdate() const {
+  if (empty()) {
+    throw logic_error("DecryptionKey: the key is empty");
+  }
+  return *keyUpdate;
+}
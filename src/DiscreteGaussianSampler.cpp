@@ -1,8 +1,5 @@
 #include "DiscreteGaussianSampler.hpp"
 
-// Initialize the static random number generator
-mt19937 DiscreteGaussianSampler::gen(random_device{}());
-
 DiscreteGaussianSampler::DiscreteGaussianSampler(double stddev, BigInt modulus)
     : m_std(stddev), modulus(modulus) {
   if (modulus == 0) {
@@ -42,7 +39,7 @@ BigInt DiscreteGaussianSampler::GenerateInteger() {
   BigInt ans;
   uniform_real_distribution<double> distribution(0.0, 1.0);
 
-  seed = distribution(gen) - 0.5;
+  seed = distribution(CryptoContext::current().rng()) - 0.5;
 
   if (abs(seed) <= m_a / 2) {
     val = 0;
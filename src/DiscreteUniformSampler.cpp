@@ -1,8 +1,5 @@
 #include "DiscreteUniformSampler.hpp"
 
-// Initialize the static random number generator
-mt19937 DiscreteUniformSampler::gen(random_device{}());
-
 DiscreteUniformSampler::DiscreteUniformSampler(BigInt modulus)
     : modulus(modulus) {
   if (modulus == 0) {
@@ -14,7 +11,7 @@ BigInt DiscreteUniformSampler::GenerateInteger() {
   uniform_int_distribution<BigInt> dist(0, modulus - 1);
 
   // Generate a random BigInt
-  BigInt result = dist(gen);
+  BigInt result = dist(CryptoContext::current().rng());
 
   return result;
 }
@@ -0,0 +1,214 @@
+#include "GadgetSampler.hpp"
+
+#include <algorithm>
+
+#include "ParamSet.hpp"
+
+// Tail cut used for every table, matching DiscreteGaussianSampler
+static const double TailAccuracy = 5e-32;
+
+// Below this width the rejection bound gets loose, so the distribution
+// around the center is evaluated directly instead
+static const double MinTableWidth = 16;
+
+GadgetSampler::GadgetSampler(BigInt q, double stddev)
+    : q(q), stddev(stddev) {
+  if (q < 2) {
+    throw invalid_argument("GadgetSampler: modulus should be at least 2");
+  }
+  k = ceil(log2(q));
+  if (k > 62) {
+    throw invalid_argument("GadgetSampler: modulus should be below 2^62");
+  }
+  sigma = stddev / 3;
+
+  // Last column of B_q: the bits of q, or 2 * e_(k-1) when q = 2^k
+  qBits.assign(k, 0);
+  if (q == (BigInt(1) << k)) {
+    qBits[k - 1] = 2;
+  } else {
+    for (unsigned int i = 0; i < k; i++) {
+      qBits[i] = (q >> i) & 1;
+    }
+  }
+
+  // d = S^-1 qBits
+  d.assign(k, 0);
+  double prev = 0;
+  for (unsigned int i = 0; i < k; i++) {
+    d[i] = (prev + qBits[i]) / 2;
+    prev = d[i];
+  }
+
+  // 9I - S S^T is tridiagonal with diagonal (5, 4, ..., 4) and 2 off the
+  // diagonal, factor it as L^T L with L lower bidiagonal
+  l.assign(k, 0);
+  h.assign(k, 0);
+  double diag = k == 1 ? 5 : 4;
+  for (unsigned int i = k - 1; i > 0; i--) {
+    l[i] = sqrt(diag);
+    h[i] = 2 / l[i];
+    diag = (i - 1 == 0 ? 5 : 4) - h[i] * h[i];
+  }
+  l[0] = sqrt(diag);
+
+  for (unsigned int i = 0; i < k; i++) {
+    perturbTables.push_back(makeTable(sigma / l[i]));
+  }
+  digitTable = makeTable(sigma);
+  lastTable = makeTable(sigma / d[k - 1]);
+}
+
+unsigned int GadgetSampler::getK() const { return k; }
+
+BigInt GadgetSampler::getModulus() const { return q; }
+
+double GadgetSampler::getStddev() const { return stddev; }
+
+GadgetSampler::Table GadgetSampler::makeTable(double width) {
+  Table table;
+  table.width = width;
+  table.logBound = 0;
+  if (width < MinTableWidth) {
+    return table;
+  }
+
+  BigInt tail =
+      static_cast<BigInt>(ceil(width * sqrt(-2 * log(TailAccuracy))));
+  double acc = 0;
+  for (BigInt y = 0; y <= tail; y++) {
+    double weight = exp(-static_cast<double>(y * y) / (2 * width * width));
+    acc += y == 0 ? weight : 2 * weight;
+    table.cdf.push_back(acc);
+  }
+  for (double& c : table.cdf) {
+    c /= acc;
+  }
+  // rho(y - f) / rho(y) = exp((2yf - f^2) / (2 width^2)) <= exp(tail / width^2)
+  table.logBound = static_cast<double>(tail) / (width * width);
+  return table;
+}
+
+BigInt GadgetSampler::sampleZ(const Table& table, double center,
+                              mt19937& rng) {
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  double width = table.width;
+  double base = floor(center);
+  double f = center - base;
+
+  if (table.cdf.empty()) {
+    // Inversion over the support around the center
+    BigInt tail =
+        static_cast<BigInt>(ceil(width * sqrt(-2 * log(TailAccuracy)))) + 1;
+    double total = 0;
+    for (BigInt y = -tail; y <= tail + 1; y++) {
+      double dist = y - f;
+      total += exp(-dist * dist / (2 * width * width));
+    }
+    double r = uniform(rng) * total;
+    for (BigInt y = -tail; y <= tail + 1; y++) {
+      double dist = y - f;
+      r -= exp(-dist * dist / (2 * width * width));
+      if (r <= 0) {
+        return static_cast<BigInt>(base) + y;
+      }
+    }
+    return static_cast<BigInt>(base) + tail + 1;
+  }
+
+  while (true) {
+    double r = uniform(rng);
+    BigInt y = lower_bound(table.cdf.begin(), table.cdf.end(), r) -
+               table.cdf.begin();
+    if (y >= static_cast<BigInt>(table.cdf.size())) {
+      y = table.cdf.size() - 1;
+    }
+    if (y != 0 && (rng() & 1)) {
+      y = -y;
+    }
+    double logRatio =
+        (2 * y * f - f * f) / (2 * width * width) - table.logBound;
+    if (log(uniform(rng)) < logRatio) {
+      return static_cast<BigInt>(base) + y;
+    }
+  }
+}
+
+template <class Digits>
+void GadgetSampler::perturbFor(Digits digits, BigInt* p,
+                               mt19937& rng) const {
+  // z ~ D_{Z^k} with covariance sigma^2 (L^T L)^-1, i.e. L z spherical,
+  // sampled one coordinate at a time
+  BigInt z[64];
+  for (unsigned int i = 0; i < digits; i++) {
+    double center = i == 0 ? 0 : -h[i] * z[i - 1] / l[i];
+    z[i] = sampleZ(perturbTables[i], center, rng);
+  }
+
+  // p = L^T L z = (9I - S S^T) z
+  for (unsigned int i = 0; i < digits; i++) {
+    BigInt value = (i == 0 ? 5 : 4) * z[i];
+    if (i > 0) {
+      value += 2 * z[i - 1];
+    }
+    if (i + 1 < digits) {
+      value += 2 * z[i + 1];
+    }
+    p[i] = value;
+  }
+}
+
+template <class Digits, class Modulus>
+void GadgetSampler::sampleFor(Digits digits, Modulus modulus, BigInt u,
+                              const BigInt* p, BigInt* x,
+                              mt19937& rng) const {
+  u = (u % modulus + modulus) % modulus;
+
+  // c = S^-1 (bits(u) - p)
+  double c[64];
+  double prev = 0;
+  for (unsigned int i = 0; i < digits; i++) {
+    c[i] = (prev + static_cast<double>(((u >> i) & 1) - p[i])) / 2;
+    prev = c[i];
+  }
+
+  // Randomized nearest plane over D, last Gram-Schmidt vector d[k-1] e_(k-1)
+  // first, then the unit vectors
+  const unsigned int last = digits - 1;
+  BigInt z[64];
+  z[last] = sampleZ(lastTable, -c[last] / d[last], rng);
+  for (unsigned int i = 0; i < last; i++) {
+    z[i] = sampleZ(digitTable, -(c[i] + z[last] * d[i]), rng);
+  }
+
+  // x = B_q z + bits(u)
+  for (unsigned int i = 0; i < digits; i++) {
+    BigInt value = ((u >> i) & 1) + qBits[i] * z[last];
+    if (i + 1 < digits) {
+      value += 2 * z[i];
+    }
+    if (i > 0) {
+      value -= z[i - 1];
+    }
+    x[i] = value;
+  }
+}
+
+void GadgetSampler::perturb(BigInt* p, mt19937& rng) const {
+  withGadgetLength(k, [&](auto digits) { perturbFor(digits, p, rng); });
+}
+
+void GadgetSampler::sampleWithPerturbation(BigInt u, const BigInt* p,
+                                           BigInt* x, mt19937& rng) const {
+  withGadgetLength(k, [&](auto digits) {
+    withModulus(q, [&](auto modulus) {
+      sampleFor(digits, modulus, u, p, x, rng);
+    });
+  });
+}
+
+void GadgetSampler::sample(BigInt u, BigInt* x, mt19937& rng) const {
+  BigInt p[64];
+  perturb(p, rng);
+  sampleWithPerturbation(u, p, x, rng);
+}
@@ -1,5 +1,11 @@
 #include "Hash.hpp"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86
+#endif
+
 const size_t SHA256::InitialValues[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
                                          0xa54ff53a, 0x510e527f, 0x9b05688c,
                                          0x1f83d9ab, 0x5be0cd19};
@@ -45,6 +51,250 @@ static inline uint32_t theta1(uint32_t x) {
   return rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10);
 }
 
+static inline uint32_t loadBE32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline void storeBE32(uint8_t* p, uint32_t x) {
+  p[0] = x >> 24;
+  p[1] = x >> 16;
+  p[2] = x >> 8;
+  p[3] = x;
+}
+
+// Portable single-block compression function
+static void compressScalar(uint32_t* state, const uint8_t* chunk,
+                           const uint32_t* k) {
+  uint32_t w[64];
+  uint32_t a, b, c, d, e, f, g, h;
+
+  for (size_t i = 0; i < 16; ++i) {
+    w[i] = loadBE32(chunk + i * 4);
+  }
+
+  for (size_t i = 16; i < 64; ++i) {
+    w[i] = theta1(w[i - 2]) + w[i - 7] + theta0(w[i - 15]) + w[i - 16];
+  }
+
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
+
+  for (size_t i = 0; i < 64; ++i) {
+    uint32_t t1 = h + sig1(e) + choose(e, f, g) + k[i] + w[i];
+    uint32_t t2 = sig0(a) + majority(a, b, c);
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+#ifdef SHA256_X86
+// SHA-NI compression of consecutive blocks into one state
+__attribute__((target("sha,sse4.1,ssse3"))) static void compressShaNi(
+    uint32_t* state, const uint8_t* blocks, size_t count, const uint32_t* k) {
+  const __m128i mask =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // Reorder the state words into the ABEF / CDGH layout used by SHA-NI
+  __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+  __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);
+  state1 = _mm_shuffle_epi32(state1, 0x1B);
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for (size_t blk = 0; blk < count; ++blk) {
+    const uint8_t* chunk = blocks + blk * 64;
+    __m128i abef = state0;
+    __m128i cdgh = state1;
+    __m128i w[4];
+
+    for (int i = 0; i < 16; ++i) {
+      __m128i msg;
+      if (i < 4) {
+        msg = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(chunk + 16 * i)),
+            mask);
+      } else {
+        // W[t] from W[t-16 .. t-1], four words at a time
+        msg = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+        msg = _mm_add_epi32(msg,
+                            _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+        msg = _mm_sha256msg2_epu32(msg, w[(i + 3) & 3]);
+      }
+      w[i & 3] = msg;
+
+      __m128i wk = _mm_add_epi32(
+          msg, _mm_loadu_si128(reinterpret_cast<const __m128i*>(k + 4 * i)));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+      wk = _mm_shuffle_epi32(wk, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+template <int n>
+__attribute__((target("avx2"))) static inline __m256i rotr8(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// AVX2 compression of one block in each of eight independent lanes
+__attribute__((target("avx2"))) static void compressAvx2x8(
+    uint32_t (*states)[8], const uint8_t* const* blocks, const uint32_t* k) {
+  __m256i w[64];
+  alignas(32) uint32_t lane[8];
+
+  for (int t = 0; t < 16; ++t) {
+    for (int l = 0; l < 8; ++l) {
+      lane[l] = loadBE32(blocks[l] + 4 * t);
+    }
+    w[t] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lane));
+  }
+
+  for (int t = 16; t < 64; ++t) {
+    __m256i s0 = _mm256_xor_si256(
+        _mm256_xor_si256(rotr8<7>(w[t - 15]), rotr8<18>(w[t - 15])),
+        _mm256_srli_epi32(w[t - 15], 3));
+    __m256i s1 = _mm256_xor_si256(
+        _mm256_xor_si256(rotr8<17>(w[t - 2]), rotr8<19>(w[t - 2])),
+        _mm256_srli_epi32(w[t - 2], 10));
+    w[t] = _mm256_add_epi32(_mm256_add_epi32(s1, w[t - 7]),
+                            _mm256_add_epi32(s0, w[t - 16]));
+  }
+
+  __m256i v[8];
+  for (int j = 0; j < 8; ++j) {
+    for (int l = 0; l < 8; ++l) {
+      lane[l] = states[l][j];
+    }
+    v[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lane));
+  }
+
+  __m256i a = v[0], b = v[1], c = v[2], d = v[3];
+  __m256i e = v[4], f = v[5], g = v[6], h = v[7];
+
+  for (int t = 0; t < 64; ++t) {
+    __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(rotr8<6>(e), rotr8<11>(e)),
+                                  rotr8<25>(e));
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                  _mm256_andnot_si256(e, g));
+    __m256i t1 = _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_add_epi32(h, S1), ch),
+        _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(k[t])), w[t]));
+    __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(rotr8<2>(a), rotr8<13>(a)),
+                                  rotr8<22>(a));
+    __m256i maj = _mm256_xor_si256(
+        _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(a, c)),
+        _mm256_and_si256(b, c));
+    __m256i t2 = _mm256_add_epi32(S0, maj);
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  v[0] = _mm256_add_epi32(v[0], a);
+  v[1] = _mm256_add_epi32(v[1], b);
+  v[2] = _mm256_add_epi32(v[2], c);
+  v[3] = _mm256_add_epi32(v[3], d);
+  v[4] = _mm256_add_epi32(v[4], e);
+  v[5] = _mm256_add_epi32(v[5], f);
+  v[6] = _mm256_add_epi32(v[6], g);
+  v[7] = _mm256_add_epi32(v[7], h);
+
+  for (int j = 0; j < 8; ++j) {
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane), v[j]);
+    for (int l = 0; l < 8; ++l) {
+      states[l][j] = lane[l];
+    }
+  }
+}
+#endif
+
+bool SHA256::supportsCore(Core core) {
+  switch (core) {
+    case SCALAR:
+      return true;
+#ifdef SHA256_X86
+    case AVX2:
+      // this can run from a static initializer, before the CPU model is set
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+    case SHANI: {
+      unsigned int eax, ebx, ecx, edx;
+      if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+      }
+      bool ssse3 = ecx & (1u << 9);
+      bool sse41 = ecx & (1u << 19);
+      return ssse3 && sse41 &&
+             __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+             (ebx & (1u << 29));
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+// Pick the compression core once, based on what the running CPU supports
+static SHA256::Core detectShaCore() {
+  for (SHA256::Core core : {SHA256::SHANI, SHA256::AVX2}) {
+    if (SHA256::supportsCore(core)) {
+      return core;
+    }
+  }
+  return SHA256::SCALAR;
+}
+
+static SHA256::Core shaCore = detectShaCore();
+
+SHA256::Core SHA256::activeCore() { return shaCore; }
+
+bool SHA256::forceCore(Core core) {
+  if (!supportsCore(core)) {
+    return false;
+  }
+  shaCore = core;
+  return true;
+}
+
 SHA256::SHA256() {
   datalen = 0;
   bitlen = 0;
@@ -54,15 +304,30 @@ SHA256::SHA256() {
 }
 
 void SHA256::update(const uint8_t* data, size_t length) {
-  for (size_t i = 0; i < length; ++i) {
-    this->data[datalen] = data[i];
-    datalen++;
-    if (datalen == BlockSize) {
-      transform(this->data);
-      bitlen += BlockSize * 8;
-      datalen = 0;
+  // Top up a partially filled block first
+  if (datalen > 0) {
+    size_t take = min(BlockSize - datalen, length);
+    memcpy(this->data + datalen, data, take);
+    datalen += take;
+    data += take;
+    length -= take;
+    if (datalen < BlockSize) {
+      return;
     }
+    transform(this->data);
+    bitlen += BlockSize * 8;
+    datalen = 0;
   }
+
+  // Full blocks are compressed straight from the caller's buffer
+  size_t blocks = length / BlockSize;
+  compress(state, data, blocks);
+  bitlen += blocks * BlockSize * 8;
+  data += blocks * BlockSize;
+  length -= blocks * BlockSize;
+
+  memcpy(this->data, data, length);
+  datalen = length;
 }
 
 void SHA256::finalize() {
@@ -102,51 +367,48 @@ array<uint8_t, 32> SHA256::digest() const {
   return hash;
 }
 
-void SHA256::transform(const uint8_t* chunk) {
-  uint32_t w[64];
-  uint32_t a, b, c, d, e, f, g, h;
-
-  for (size_t i = 0; i < 16; ++i) {
-    w[i] = (chunk[i * 4] << 24) | (chunk[i * 4 + 1] << 16) |
-           (chunk[i * 4 + 2] << 8) | (chunk[i * 4 + 3]);
+void SHA256::compress(uint32_t* state, const uint8_t* blocks, size_t count) {
+#ifdef SHA256_X86
+  if (shaCore == SHANI) {
+    compressShaNi(state, blocks, count, K);
+    return;
   }
-
-  for (size_t i = 16; i < 64; ++i) {
-    w[i] = theta1(w[i - 2]) + w[i - 7] + theta0(w[i - 15]) + w[i - 16];
+#endif
+  for (size_t i = 0; i < count; ++i) {
+    compressScalar(state, blocks + i * BlockSize, K);
   }
+}
 
-  a = state[0];
-  b = state[1];
-  c = state[2];
-  d = state[3];
-  e = state[4];
-  f = state[5];
-  g = state[6];
-  h = state[7];
-
-  for (size_t i = 0; i < 64; ++i) {
-    uint32_t t1 = h + sig1(e) + choose(e, f, g) + K[i] + w[i];
-    uint32_t t2 = sig0(a) + majority(a, b, c);
-    h = g;
-    g = f;
-    f = e;
-    e = d + t1;
-    d = c;
-    c = b;
-    b = a;
-    a = t1 + t2;
+void SHA256::compressLanes(uint32_t (*states)[8], const uint8_t* const* blocks,
+                           size_t lanes) {
+#ifdef SHA256_X86
+  if (shaCore == AVX2 && lanes > 1) {
+    if (lanes == 8) {
+      compressAvx2x8(states, blocks, K);
+      return;
+    }
+    // Fill the unused lanes with copies of the first one
+    uint32_t padded[8][8];
+    const uint8_t* ptrs[8];
+    for (size_t l = 0; l < 8; ++l) {
+      size_t src = l < lanes ? l : 0;
+      memcpy(padded[l], states[src], sizeof(padded[l]));
+      ptrs[l] = blocks[src];
+    }
+    compressAvx2x8(padded, ptrs, K);
+    for (size_t l = 0; l < lanes; ++l) {
+      memcpy(states[l], padded[l], sizeof(padded[l]));
+    }
+    return;
+  }
+#endif
+  for (size_t l = 0; l < lanes; ++l) {
+    compress(states[l], blocks[l], 1);
   }
-
-  state[0] += a;
-  state[1] += b;
-  state[2] += c;
-  state[3] += d;
-  state[4] += e;
-  state[5] += f;
-  state[6] += g;
-  state[7] += h;
 }
 
+void SHA256::transform(const uint8_t* chunk) { compress(state, chunk, 1); }
+
 void SHA256::revert(uint8_t* hash) {
   for (size_t i = 0; i < 4; ++i) {
     for (size_t j = 0; j < 8; ++j) {
@@ -162,37 +424,283 @@ array<uint8_t, 32> SHA256::hash(const string& input) {
   return sha256.digest();
 }
 
-Hash::Hash(int r, int c) : rows(r), cols(c) {}
+void SHA256::hashCounter(const uint8_t* input, size_t length, uint32_t first,
+                         size_t count, uint8_t* out) {
+  hashCounter(SHA256(), input, length, first, count, out);
+}
+
+void SHA256::hashCounter(const SHA256& prefix, const uint8_t* input,
+                         size_t length, uint32_t first, size_t count,
+                         uint8_t* out) {
+  // The full blocks of prefix || input are shared by every message, absorb
+  // them once into a midstate
+  SHA256 shared = prefix;
+  shared.update(input, length);
+  const uint32_t* midstate = shared.state;
+
+  // Padded tail: rest of input || counter || 0x80 || 0x00... || bit length
+  size_t restLen = shared.datalen;
+  size_t tailLen = restLen + sizeof(uint32_t);
+  size_t tailBlocks = (tailLen + 9 + BlockSize - 1) / BlockSize;
+  uint64_t bits = shared.bitlen + static_cast<uint64_t>(tailLen) * 8;
+
+  uint8_t tail[8][2 * BlockSize];
+  memset(tail[0], 0, sizeof(tail[0]));
+  memcpy(tail[0], shared.data, restLen);
+  tail[0][tailLen] = 0x80;
+  for (size_t j = 0; j < 8; ++j) {
+    tail[0][tailBlocks * BlockSize - 1 - j] = bits >> (j * 8);
+  }
+  for (size_t l = 1; l < 8; ++l) {
+    memcpy(tail[l], tail[0], tailBlocks * BlockSize);
+  }
+
+  uint32_t states[8][8];
+  const uint8_t* ptrs[8];
+  for (size_t base = 0; base < count; base += 8) {
+    size_t lanes = min<size_t>(8, count - base);
+    for (size_t l = 0; l < lanes; ++l) {
+      uint32_t ctr = first + static_cast<uint32_t>(base + l);
+      for (size_t j = 0; j < sizeof(uint32_t); ++j) {
+        tail[l][restLen + j] = ctr >> (j * 8);
+      }
+      memcpy(states[l], midstate, sizeof(states[l]));
+    }
+    for (size_t b = 0; b < tailBlocks; ++b) {
+      for (size_t l = 0; l < lanes; ++l) {
+        ptrs[l] = tail[l] + b * BlockSize;
+      }
+      compressLanes(states, ptrs, lanes);
+    }
+    for (size_t l = 0; l < lanes; ++l) {
+      uint8_t* digest = out + (base + l) * HashSize;
+      for (size_t j = 0; j < 8; ++j) {
+        storeBE32(digest + 4 * j, states[l][j]);
+      }
+    }
+  }
+}
+
+static const uint64_t KeccakRC[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+    0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+static const unsigned int KeccakRho[24] = {1,  3,  6,  10, 15, 21, 28, 36,
+                                           45, 55, 2,  14, 27, 41, 56, 8,
+                                           25, 43, 62, 18, 39, 61, 20, 44};
+
+static const unsigned int KeccakPi[24] = {10, 7,  11, 17, 18, 3,  5,  16,
+                                          8,  21, 24, 4,  15, 23, 19, 13,
+                                          12, 2,  20, 14, 22, 9,  6,  1};
+
+static inline uint64_t rotl64(uint64_t x, unsigned int n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+SHAKE128::SHAKE128() : pos(0), finalized(false) {
+  memset(state, 0, sizeof(state));
+}
+
+void SHAKE128::permute(uint64_t* a) {
+  uint64_t c[5];
+  for (int round = 0; round < 24; ++round) {
+    // theta
+    for (int x = 0; x < 5; ++x) {
+      c[x] = a[x] ^ a[x + 5] ^ a[x + 10] ^ a[x + 15] ^ a[x + 20];
+    }
+    for (int x = 0; x < 5; ++x) {
+      uint64_t d = c[(x + 4) % 5] ^ rotl64(c[(x + 1) % 5], 1);
+      for (int y = 0; y < 25; y += 5) {
+        a[x + y] ^= d;
+      }
+    }
+
+    // rho and pi
+    uint64_t t = a[1];
+    for (int i = 0; i < 24; ++i) {
+      uint64_t next = a[KeccakPi[i]];
+      a[KeccakPi[i]] = rotl64(t, KeccakRho[i]);
+      t = next;
+    }
+
+    // chi
+    for (int y = 0; y < 25; y += 5) {
+      for (int x = 0; x < 5; ++x) {
+        c[x] = a[x + y];
+      }
+      for (int x = 0; x < 5; ++x) {
+        a[x + y] = c[x] ^ (~c[(x + 1) % 5] & c[(x + 2) % 5]);
+      }
+    }
+
+    // iota
+    a[0] ^= KeccakRC[round];
+  }
+}
+
+void SHAKE128::update(const uint8_t* data, size_t length) {
+  if (finalized) {
+    throw logic_error("SHAKE128: update after finalize");
+  }
+  // Whole rate-sized blocks are absorbed a lane at a time
+  while (pos == 0 && length >= Rate) {
+    for (size_t i = 0; i < Rate / 8; ++i) {
+      uint64_t lane = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        lane |= static_cast<uint64_t>(data[8 * i + j]) << (8 * j);
+      }
+      state[i] ^= lane;
+    }
+    permute(state);
+    data += Rate;
+    length -= Rate;
+  }
+  for (size_t i = 0; i < length; ++i) {
+    state[pos / 8] ^= static_cast<uint64_t>(data[i]) << (8 * (pos % 8));
+    if (++pos == Rate) {
+      permute(state);
+      pos = 0;
+    }
+  }
+}
+
+void SHAKE128::finalize() {
+  // SHAKE domain separation and pad10*1
+  state[pos / 8] ^= 0x1FULL << (8 * (pos % 8));
+  state[(Rate - 1) / 8] ^= 0x80ULL << (8 * ((Rate - 1) % 8));
+  permute(state);
+  pos = 0;
+  finalized = true;
+}
+
+void SHAKE128::squeeze(uint8_t* out, size_t length) {
+  if (!finalized) {
+    finalize();
+  }
+  for (size_t i = 0; i < length; ++i) {
+    if (pos == Rate) {
+      permute(state);
+      pos = 0;
+    }
+    out[i] = state[pos / 8] >> (8 * (pos % 8));
+    ++pos;
+  }
+}
+
+Hash::Hash(int r, int c, HashBackend backend)
+    : rows(r), cols(c), backend(backend) {}
+
+Hash Hash::withPrefix(const string& prefix) const {
+  Hash prefixed = *this;
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(prefix.data());
+  prefixed.shaPrefix.update(bytes, prefix.size());
+  prefixed.shakePrefix.update(bytes, prefix.size());
+  return prefixed;
+}
 
 Matrix Hash::hash(const string& input) {
+  if (backend == HashBackend::SHAKE128_XOF) {
+    return hashSHAKE128(input);
+  }
+  return hashSHA256(input);
+}
+
+Matrix Hash::hashSHA256(const string& input) {
   BigInt q = Matrix::getModulus();
 
   Matrix matrix(rows, cols);
-  size_t bytes_needed = rows * cols * sizeof(BigInt);
-  vector<uint8_t> random_bytes(bytes_needed);
+  const size_t entries = static_cast<size_t>(rows) * cols;
+  const size_t perDigest = SHA256::HashSize / sizeof(BigInt);
+
+  // Digests are produced in batches small enough to stay in L1 and are
+  // written straight into the rows of the result
+  const size_t batch = 64;
+  uint8_t digests[batch * SHA256::HashSize];
 
-  string hash_input = input;
-  size_t hash_output_length = SHA256::HashSize;
-  array<uint8_t, 32> hash_output;
-  size_t byte_index = 0;
+  size_t entry = 0;
+  unsigned int r = 0, c = 0;
+  BigInt* row = entries > 0 ? matrix.rowData(0) : nullptr;
+  for (uint32_t counter = 0; entry < entries; counter += batch) {
+    size_t count = min(batch, (entries - entry + perDigest - 1) / perDigest);
+    SHA256::hashCounter(shaPrefix,
+                        reinterpret_cast<const uint8_t*>(input.data()),
+                        input.size(), counter, count, digests);
 
-  while (byte_index < bytes_needed) {
-    hash_output = SHA256::hash(hash_input);
-    size_t copy_size = min(hash_output_length, bytes_needed - byte_index);
-    memcpy(random_bytes.data() + byte_index, hash_output.data(),
-                copy_size);
-    byte_index += copy_size;
-    hash_input = string(hash_output.begin(), hash_output.end());
+    size_t available = min(count * perDigest, entries - entry);
+    for (size_t i = 0; i < available; ++i, ++entry) {
+      uint64_t value = 0;
+      memcpy(&value, digests + i * sizeof(uint64_t), sizeof(uint64_t));
+      row[c] = static_cast<BigInt>(value % static_cast<uint64_t>(q));
+      if (++c == static_cast<unsigned int>(cols)) {
+        c = 0;
+        if (++r < static_cast<unsigned int>(rows)) {
+          row = matrix.rowData(r);
+        }
+      }
+    }
   }
 
-  for (int i = 0; i < rows; ++i) {
-    for (int j = 0; j < cols; ++j) {
-      BigInt value = 0;
-      memcpy(&value, random_bytes.data() + (i * cols + j) * sizeof(BigInt),
-                  sizeof(BigInt));
-      matrix.set(i, j, value % q);
+  return matrix;
+}
+
+Matrix Hash::hashSHAKE128(const string& input) {
+  BigInt q = Matrix::getModulus();
+  unsigned int bits = Matrix::getK();
+
+  Matrix matrix(rows, cols);
+  const size_t entries = static_cast<size_t>(rows) * cols;
+
+  SHAKE128 xof = shakePrefix;
+  xof.update(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  xof.finalize();
+
+  uint8_t block[SHAKE128::Rate];
+  size_t entry = 0;
+  unsigned int r = 0, c = 0;
+  BigInt* row = entries > 0 ? matrix.rowData(0) : nullptr;
+  auto accept = [&](BigInt candidate) {
+    if (candidate >= q || entry == entries) {
+      return;
+    }
+    row[c] = candidate;
+    ++entry;
+    if (++c == static_cast<unsigned int>(cols)) {
+      c = 0;
+      if (++r < static_cast<unsigned int>(rows)) {
+        row = matrix.rowData(r);
+      }
+    }
+  };
+
+  uint64_t acc = 0;
+  unsigned int accBits = 0;
+  const uint64_t mask = (1ULL << bits) - 1;
+  while (entry < entries) {
+    xof.squeeze(block, SHAKE128::Rate);
+    if (bits == 12) {
+      // Two candidates from every three bytes, as in Kyber's Parse
+      for (size_t i = 0; i < SHAKE128::Rate; i += 3) {
+        accept(block[i] | ((block[i + 1] & 0x0F) << 8));
+        accept((block[i + 1] >> 4) | (block[i + 2] << 4));
+      }
+    } else {
+      for (size_t i = 0; i < SHAKE128::Rate; ++i) {
+        acc |= static_cast<uint64_t>(block[i]) << accBits;
+        accBits += 8;
+        while (accBits >= bits) {
+          accept(static_cast<BigInt>(acc & mask));
+          acc >>= bits;
+          accBits -= bits;
+        }
+      }
     }
   }
 
   return matrix;
-}
\ No newline at end of file
+}
@@ -1,332 +1,446 @@
 #include "IB-ME.hpp"
 #include <chrono>
 
-IBME::IBME() {
-  Matrix::setModulus(MODULUS);
+// Counts an interactive request as running for the lifetime of the object
+class InteractiveScope {
+ public:
+  explicit InteractiveScope(atomic<int>& counter) : counter(counter) {
+    counter++;
+  }
+  ~InteractiveScope() { counter--; }
+
+ private:
+  atomic<int>& counter;
+};
+
+IBME::IBME(unsigned int capacity, shared_ptr<CryptoContext> context,
+           const SchemeParams& params)
+    : params(params),
+      context(context != nullptr
+                  ? context
+                  : make_shared<CryptoContext>(params.q, params.sigma)),
+      // identities, epochs and messages are all hashed with the SHAKE128
+      // XOF, each hash with its own domain tag absorbed once up front
+      hashBackend(HashBackend::SHAKE128_XOF),
+      hashId(Hash(params.n, params.n, hashBackend).withPrefix("IBME.H.")),
+      hashSender(Hash(params.n, params.m, hashBackend).withPrefix("IBME.H1.")),
+      hashMessage(Hash(params.n, 1, hashBackend).withPrefix("IBME.H2.")),
+      hashNode(
+          Hash(params.n, SLOT_CHUNK, hashBackend).withPrefix("IBME.U1.")),
+      cache(CACHE_CAPACITY),
+      tree(capacity),
+      RL(capacity) {
+  CryptoContext::Scope active(*this->context);
+  Matrix::setModulus(params.q);
   BigInt q = Matrix::getModulus();
-  unsigned int n = ROWS;
+  unsigned int n = params.n;
   unsigned int k = Matrix::getK();
   unsigned int m = n * k;
+  if (k != params.k || m != params.m) {
+    throw invalid_argument("IBME: k and m do not match the modulus");
+  }
 
-  MP12 MP(q, SIGMA);
+  MP12 MP(q, params.sigma);
 
-  pair<Matrix, Matrix> trapPairA = MP12::trapGen(n);
-  pair<Matrix, Matrix> trapPairA_prime = MP12::trapGen(n);
-  cout << "trapPairA.first size = " << trapPairA.first.getRows() << " x " << trapPairA.first.getCols() << endl;
+  // A and A' are in Hermite normal form, only the part after I_n is kept
+  pair<Matrix, Matrix> trapPairA = MP12::trapGenHNF(n);
+  pair<Matrix, Matrix> trapPairA_prime = MP12::trapGenHNF(n);
 
   Matrix B1 = Matrix::generateUniformRandomMatrix(n, 2 * m);
   Matrix B2 = Matrix::generateUniformRandomMatrix(n, 2 * m);
   Matrix C1 = Matrix::generateUniformRandomMatrix(n, 2 * m);
   Matrix C2 = Matrix::generateUniformRandomMatrix(n, 2 * m);
 
-  vector<Matrix> u;
-  for (unsigned int i = 0; i < N; i++) {
-    Matrix u_i = Matrix::generateUniformRandomMatrix(n, 1);
-    u.push_back(u_i);
-  }
+  Matrix U_t = Matrix::generateUniformRandomMatrix(params.slots, n);
 
-  // output trapPair1, trapPair2, B1, B2, C1, C2, u
+  // output trapPair1, trapPair2, B1, B2, C1, C2, U
   this->A = trapPairA.first;
   this->A_prime = trapPairA_prime.first;
-  this->trapdoorA = trapPairA.second;
-  this->trapdoorA_prime = trapPairA_prime.second;
+  this->trapdoorA = Trapdoor(trapPairA.second);
+  this->trapdoorA_prime = Trapdoor(trapPairA_prime.second);
   this->B1 = B1;
   this->B2 = B2;
   this->C1 = C1;
   this->C2 = C2;
-  this->u = u;
+  this->U_t = U_t;
+
+  // Seed of the node PRF, the targets u1 of every tree node follow from it.
+  // It is drawn from the context like the rest of the setup, so a context
+  // with a fixed seed gives the same tree every run.
+  mt19937& gen = this->context->rng();
+  string seed;
+  for (int i = 0; i < 32; i++) {
+    seed += static_cast<char>(gen() & 0xff);
+  }
+  hashNode = hashNode.withPrefix(seed);
+}
+
+shared_ptr<const Matrix> IBME::receiverMatrix(int receiver_id) {
+  return cache.get(MatrixCache::RECEIVER, receiver_id, [&]() {
+    return B1 + hashId.hash(to_string(receiver_id)) * C1;
+  });
+}
 
-  tree = new BinaryTree(USER_NUM);
-  RL = {};
+shared_ptr<const Matrix> IBME::epochMatrix(int t) {
+  return cache.get(MatrixCache::EPOCH, t, [&]() {
+    return B2 + hashId.hash(to_string(t)) * C2;
+  });
 }
 
-Matrix IBME::SKGen(int sender_id) {
-  if (sender_id < 0 || sender_id >= USER_NUM) {
+shared_ptr<const Matrix> IBME::senderMatrix(int sender_id) {
+  return cache.get(MatrixCache::SENDER, sender_id,
+                   [&]() { return hashSender.hash(to_string(sender_id)); });
+}
+
+const SchemeParams& IBME::getParams() const { return params; }
+
+CryptoContext& IBME::getContext() const { return *context; }
+
+const MatrixCache& IBME::getCache() const { return cache; }
+
+unsigned int IBME::getCapacity() const { return tree.getCapacity(); }
+
+bool IBME::interactivePending() const { return interactive.load() > 0; }
+
+void IBME::warmCache(int t, int epochs) {
+  CryptoContext::Scope active(*context);
+  // Make room for everything warmed here, or the epochs warmed last would
+  // evict the receivers and senders warmed first
+  cache.reserve(2 * static_cast<size_t>(getCapacity()) + max(epochs, 0));
+  for (int id = 0; id < static_cast<int>(getCapacity()); id++) {
+    receiverMatrix(id);
+    senderMatrix(id);
+  }
+  for (int i = 0; i < epochs; i++) {
+    epochMatrix(t + i);
+  }
+}
+
+void IBME::startPrecomputation(size_t capacity, size_t threads) {
+  CryptoContext::Scope active(*context);
+  unsigned int m = A.getRows() * Matrix::getK();
+  signPool.reset(new PerturbationPool(A.getRows(), 0, 0, capacity, threads));
+  sampleLeftPool.reset(new PerturbationPool(A.getRows(), 2 * m, params.sigma,
+                                            capacity, threads));
+}
+
+void IBME::stopPrecomputation() {
+  signPool.reset();
+  sampleLeftPool.reset();
+}
+
+Trapdoor IBME::SKGen(int sender_id) {
+  CryptoContext::Scope active(*context);
+  if (sender_id < 0 || sender_id >= static_cast<int>(getCapacity())) {
     throw invalid_argument(
-        "SKGen: invalid sender ID, should be between 0 and USER_NUM - 1");
+        "SKGen: invalid sender ID, should be between 0 and capacity - 1");
   }
+  InteractiveScope scope(interactive);
 
   unsigned int n = A.getRows();
   BigInt q = Matrix::getModulus();
   unsigned int k = Matrix::getK();
   unsigned int m = n * k;
 
-  Hash h1 = Hash(n, m);
-  Matrix h_senderid = h1.hash(to_string(sender_id));
-
-  Matrix F_senderid = Matrix::horizontalConcat(A_prime, h_senderid);
+  shared_ptr<const Matrix> h_senderid = senderMatrix(sender_id);
 
-  Matrix ek_senderid =
-      MP12::delTrap(A_prime, trapdoorA_prime, h_senderid, SIGMA).second;
+  Trapdoor ek_senderid =
+      MP12::delTrap(A_prime, trapdoorA_prime, *h_senderid).second;
 
   return ek_senderid;
 }
 
-vector<pair<TreeNode*, vector<Matrix>>> IBME::RKGen(int receiver_id) {
-  if (receiver_id < 0 || receiver_id >= USER_NUM) {
-    throw invalid_argument(
-        "RKGen: invalid receiver ID, should be between 0 and USER_NUM - 1");
+vector<Trapdoor> IBME::SKGenBatch(const vector<int>& sender_ids,
+                                  vector<double>* latency_ms) {
+  CryptoContext::Scope active(*context);
+  for (int sender_id : sender_ids) {
+    if (sender_id < 0 || sender_id >= static_cast<int>(getCapacity())) {
+      throw invalid_argument(
+          "SKGenBatch: invalid sender ID, should be between 0 and capacity - "
+          "1");
+    }
   }
+  InteractiveScope scope(interactive);
 
-  unsigned int n = A.getRows();
-  BigInt q = Matrix::getModulus();
-  unsigned int k = Matrix::getK();
-  unsigned int m = n * k;
+  // Hash every sender once up front, repeated IDs share the cached matrix
+  ThreadPool& pool = ThreadPool::instance();
+  pool.parallelFor(0, sender_ids.size(),
+                   [&](size_t i) { senderMatrix(sender_ids[i]); });
 
-  TreeNode* v = tree->findithLeaf(receiver_id);
-  set<TreeNode*> pathNodes = tree->path(v);
-
-  vector<pair<TreeNode*, vector<Matrix>>> rk_receiverid;
-
-  Hash h = Hash(n, n);
-
-  // iterate pathNodes
-  for (auto node : pathNodes) {
-    pair<TreeNode*, vector<Matrix>> rk_node;
-    rk_node.first = node;
-    
-    auto start = chrono::high_resolution_clock::now();
-    if (node->u1.empty()) {
-      for (unsigned int i = 0; i < N; i++) {
-        Matrix temp = Matrix::generateUniformRandomMatrix(n, 1);
-        node->u1.push_back(temp);
-        node->u2.push_back(u[i] - temp);
-      }
+  vector<Trapdoor> ek(sender_ids.size());
+  if (latency_ms != nullptr) {
+    latency_ms->assign(sender_ids.size(), 0);
+  }
+  pool.parallelFor(0, sender_ids.size(), [&](size_t i) {
+    auto start = chrono::steady_clock::now();
+    ek[i] = SKGen(sender_ids[i]);
+    auto stop = chrono::steady_clock::now();
+    if (latency_ms != nullptr) {
+      (*latency_ms)[i] =
+          chrono::duration<double, milli>(stop - start).count();
     }
-    // cout << "node->u1.size() = " << node->u1.size() << endl;
-    // cout << "node->u2.size() = " << node->u2.size() << endl;
-
-    for (unsigned int i = 0; i < N; i++) {
-      Matrix e_i_1 = MP12::SampleLeft(
-          A, B1 + h.hash(to_string(receiver_id)) * C1, trapdoorA, node->u1[i]);
-      rk_node.second.push_back(e_i_1);
-
-      Matrix F_receiverid =
-          Matrix::horizontalConcat(A, B1 + h.hash(to_string(receiver_id)) * C1);
-      if (F_receiverid * e_i_1 != node->u1[i]) {
-        throw runtime_error("RKGen: the generated receiver key is not correct");
-      }
+  });
+  return ek;
+}
+
+Matrix IBME::targetBlock(unsigned int first, unsigned int count) const {
+  unsigned int n = U_t.getCols();
+  if (first + count > U_t.getRows()) {
+    throw out_of_range("targetBlock: columns out of range");
+  }
+  Matrix block(n, count);
+  for (unsigned int i = 0; i < count; i++) {
+    const BigInt* u_i = U_t.rowData(first + i);
+    for (unsigned int j = 0; j < n; j++) {
+      block.rowData(j)[i] = u_i[j];
     }
-    auto end = chrono::high_resolution_clock::now();
-    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
-    cout << "Time taken for one node in RKGen: " << duration.count() << " microseconds" << endl;
-    rk_receiverid.push_back(rk_node);
   }
+  return block;
+}
 
-  return rk_receiverid;
+Matrix IBME::nodeTargets(unsigned int v, unsigned int first,
+                         bool receiverHalf) {
+  unsigned int count = min<unsigned int>(SLOT_CHUNK, params.slots - first);
+  Matrix u1 = hashNode.hash(to_string(v) + "." + to_string(first));
+  if (count < SLOT_CHUNK) {
+    u1 = u1.getColBlock(0, count);
+  }
+  return receiverHalf ? u1 : targetBlock(first, count) - u1;
 }
 
-vector<pair<TreeNode*, vector<Matrix>>> IBME::KUpdGen(
-    const set<pair<TreeNode*, int>>& RL, int t) {
-  if (t < 0) {
-    throw invalid_argument("KUpdGen: t should be greater than or equal to 0");
+void IBME::sampleNodeChunk(const TreeNode* node, bool receiverHalf,
+                           const Matrix& M1, const Matrix& F,
+                           unsigned int first, KeyBlock& out) {
+  Matrix U = nodeTargets(node->index, first, receiverHalf);
+  Matrix E = MP12::SampleLeftBatch(A, M1, trapdoorA, U, sampleLeftPool.get());
+  if (Matrix::multiplyHNF(F, E) != U) {
+    throw runtime_error(
+        receiverHalf ? "RKGen: the generated receiver key is not correct"
+                     : "KUpdGen: the generated update key is not correct");
   }
+  out.setSlots(first, E);
+}
 
-  unsigned int n = A.getRows();
-  BigInt q = Matrix::getModulus();
-  unsigned int k = Matrix::getK();
-  unsigned int m = n * k;
+void IBME::sampleNodeKeys(const vector<TreeNode*>& nodes, bool receiverHalf,
+                          const Matrix& M1, const Matrix& F,
+                          vector<KeyBlock>& keys) {
+  // Every (node, slot range) pair is an independent task on the pool, and
+  // each task writes its own slots of the preallocated per-node output
+  unsigned int length = trapdoorA.getPreimageRows() + M1.getCols();
+  keys.assign(nodes.size(), KeyBlock(params.slots, length));
+  const size_t chunks = (params.slots + SLOT_CHUNK - 1) / SLOT_CHUNK;
+  ThreadPool::instance().parallelFor(0, nodes.size() * chunks, [&](size_t t) {
+    sampleNodeChunk(nodes[t / chunks], receiverHalf, M1, F,
+                    (t % chunks) * SLOT_CHUNK, keys[t / chunks]);
+  });
+}
 
-  set<TreeNode*> U = tree->KUNodes(RL, t);
+NodeKeys IBME::RKGen(int receiver_id) {
+  CryptoContext::Scope active(*context);
+  if (receiver_id < 0 || receiver_id >= static_cast<int>(getCapacity())) {
+    throw invalid_argument(
+        "RKGen: invalid receiver ID, should be between 0 and capacity - 1");
+  }
+  InteractiveScope scope(interactive);
 
-  vector<pair<TreeNode*, vector<Matrix>>> ku_t;
+  // root first, so the node order of the key is fixed
+  vector<TreeNode*> nodes = tree.path(tree.findithLeaf(receiver_id));
 
-  Hash h = Hash(n, n);
+  shared_ptr<const Matrix> F_rcv = receiverMatrix(receiver_id);
+  Matrix F_receiverid = Matrix::horizontalConcat(A, *F_rcv);
 
-  for (auto node : U) {
-    pair<TreeNode*, vector<Matrix>> ku_node;
-    ku_node.first = node;
+  vector<KeyBlock> keys;
+  sampleNodeKeys(nodes, true, *F_rcv, F_receiverid, keys);
 
-    if (node->u2.empty()) {
-      for (unsigned int i = 0; i < N; i++) {
-        Matrix temp = Matrix::generateUniformRandomMatrix(n, 1);
-        node->u2.push_back(temp);
-        node->u1.push_back(u[i] - temp);
-      }
-    }
+  NodeKeys rk_receiverid;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    keys[i].tag(KeyBlock::RECEIVER_KEY, receiver_id);
+    rk_receiverid.push_back(
+        make_pair(nodes[i], make_shared<const KeyBlock>(std::move(keys[i]))));
+  }
+  return rk_receiverid;
+}
+
+NodeKeys IBME::KUpdGen(const RevocationList& RL, int t) {
+  CryptoContext::Scope active(*context);
+  if (t < 0) {
+    throw invalid_argument("KUpdGen: t should be greater than or equal to 0");
+  }
 
-    for (unsigned int i = 0; i < N; i++) {
-      Matrix e_i_2 = MP12::SampleLeft(A, B2 + h.hash(to_string(t)) * C2,
-                                      trapdoorA, node->u2[i]);
-      ku_node.second.push_back(e_i_2);
+  vector<TreeNode*> nodes = tree.KUNodes(RL, t);
 
-      Matrix F_t = Matrix::horizontalConcat(A, B2 + h.hash(to_string(t)) * C2);
+  shared_ptr<const Matrix> F_epoch = epochMatrix(t);
+  Matrix F_t = Matrix::horizontalConcat(A, *F_epoch);
 
-      if (F_t * e_i_2 != node->u2[i]) {
-        throw runtime_error("KUpdGen: the generated update key is not correct");
-      }
-    }
+  vector<KeyBlock> keys;
+  sampleNodeKeys(nodes, false, *F_epoch, F_t, keys);
 
-    ku_t.push_back(ku_node);
+  NodeKeys ku_t;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    keys[i].tag(KeyBlock::KEY_UPDATE, t);
+    ku_t.push_back(
+        make_pair(nodes[i], make_shared<const KeyBlock>(std::move(keys[i]))));
   }
-
   return ku_t;
 }
 
-vector<pair<Matrix, Matrix>> IBME::DKGen(
-    const vector<pair<TreeNode*, vector<Matrix>>>& rk_receiverid,
-    int receiver_id, const vector<pair<TreeNode*, vector<Matrix>>>& ku_t,
-    int t) {
-  unsigned int n = A.getRows();
-  BigInt q = Matrix::getModulus();
-  unsigned int k = Matrix::getK();
-  unsigned int m = n * k;
-
-  vector<pair<Matrix, Matrix>> dk_receiverid_t;
-
-  for (auto rk : rk_receiverid) {
-    for (auto ku : ku_t) {
-      if (rk.first == ku.first) {
-        // cout << "found a match" << endl;
-        if (rk.second.size() != N || ku.second.size() != N) {
-          throw runtime_error("rk.second.size() != N || ku.second.size() != N");
-        }
-        // make each element of rk.second and ku.second a pair
-        for (unsigned int i = 0; i < N; i++) {
-          pair<Matrix, Matrix> dk_i;
-          dk_i.first = rk.second[i];
-          dk_i.second = ku.second[i];
-          dk_receiverid_t.push_back(dk_i);
-        }
-      }
+DecryptionKey IBME::DKGen(const NodeKeys& rk_receiverid, int receiver_id,
+                          const NodeKeys& ku_t, int t) {
+  // The decryption key is the receiver key and the key update of the node
+  // the receiver path shares with the update cover. The cover is sorted by
+  // node index, so each of the O(log n) path nodes is a binary search.
+  auto byIndex = [](const pair<TreeNode*, shared_ptr<const KeyBlock>>& a,
+                    unsigned int v) { return a.first->index < v; };
+  for (const auto& rk : rk_receiverid) {
+    if (rk.second->getPurpose() != KeyBlock::RECEIVER_KEY ||
+        rk.second->getOwner() != receiver_id) {
+      throw invalid_argument("DKGen: receiver key is not for receiver_id");
     }
   }
-
-  if (dk_receiverid_t.size() == 0) {
-    throw runtime_error(
-        "DKGen: cannot generate a proper decryption key, "
-        "probably caused by a revoked receiver key");
+  for (const auto& ku : ku_t) {
+    if (ku.second->getPurpose() != KeyBlock::KEY_UPDATE ||
+        ku.second->getOwner() != t) {
+      throw invalid_argument("DKGen: key update is not for epoch t");
+    }
+  }
+  // The search below needs the cover in node index order, as KUpdGen
+  // emits it
+  if (!is_sorted(ku_t.begin(), ku_t.end(),
+                 [](const pair<TreeNode*, shared_ptr<const KeyBlock>>& a,
+                    const pair<TreeNode*, shared_ptr<const KeyBlock>>& b) {
+                   return a.first->index < b.first->index;
+                 })) {
+    throw invalid_argument("DKGen: key update is not sorted by node index");
   }
+  for (const auto& rk : rk_receiverid) {
+    auto ku = lower_bound(ku_t.begin(), ku_t.end(), rk.first->index, byIndex);
+    if (ku == ku_t.end() || ku->first->index != rk.first->index) {
+      continue;
+    }
+    if (rk.second->getSlots() != params.slots ||
+        ku->second->getSlots() != params.slots) {
+      throw runtime_error("DKGen: key blocks do not hold N slots");
+    }
+    return DecryptionKey(rk.first->index, rk.second, ku->second);
+  }
+
+  throw runtime_error(
+      "DKGen: cannot generate a proper decryption key, "
+      "probably caused by a revoked receiver key");
+}
 
-  Hash h = Hash(n, n);
+void IBME::checkDecryptionKey(const DecryptionKey& dk, int receiver_id,
+                              int t) {
+  CryptoContext::Scope active(*context);
+  // Check F_id e1 + F_t e2 = u block by block
   Matrix F_receiverid =
-      Matrix::horizontalConcat(A, B1 + h.hash(to_string(receiver_id)) * C1);
-  Matrix F_t = Matrix::horizontalConcat(A, B2 + h.hash(to_string(t)) * C2);
-  for (unsigned i = 0; i < N; i++) {
-    if (F_receiverid * dk_receiverid_t[i].first +
-            F_t * dk_receiverid_t[i].second !=
-        u[i]) {
+      Matrix::horizontalConcat(A, *receiverMatrix(receiver_id));
+  Matrix F_t = Matrix::horizontalConcat(A, *epochMatrix(t));
+  for (unsigned int first = 0; first < params.slots; first += SLOT_CHUNK) {
+    unsigned int count = min<unsigned int>(SLOT_CHUNK, params.slots - first);
+    Matrix sum =
+        Matrix::multiplyHNF(F_receiverid,
+                            dk.getReceiverKey().getSlotBlock(first, count)) +
+        Matrix::multiplyHNF(F_t, dk.getKeyUpdate().getSlotBlock(first, count));
+    if (sum != targetBlock(first, count)) {
       throw runtime_error("DKGen: the generated decryption key is not correct");
     }
   }
+}
 
-  return dk_receiverid_t;
+Ciphertext IBME::Enc(const Trapdoor& ek_senderid, int sender_id,
+                     int receiver_id, const bitset<MESSAGE_LEN>& message,
+                     int t) {
+  return Enc(ek_senderid, sender_id, receiver_id, message.to_string(), t);
 }
 
-pair<vector<Matrix>, Matrix> IBME::Enc(const Matrix& ek_senderid, int sender_id,
-                                       int receiver_id,
-                                       const bitset<MESSAGE_LEN>& message,
-                                       int t) {
+Ciphertext IBME::Enc(const Trapdoor& ek_senderid, int sender_id,
+                     int receiver_id, const string& message, int t) {
+  CryptoContext::Scope active(*context);
   if (sender_id == receiver_id) {
     throw invalid_argument("sender_id == receiver_id");
   }
+  if (message.size() != params.messageLen ||
+      message.find_first_not_of("01") != string::npos) {
+    throw invalid_argument("Enc: message should be messageLen bits");
+  }
 
   unsigned int n = A.getRows();
   BigInt q = Matrix::getModulus();
   unsigned int k = Matrix::getK();
   unsigned int m = n * k;
 
-  string message_bitstring = message.to_string();
-
-  Hash h = Hash(n, n);
-  Hash h1 = Hash(n, m);
-  Hash h2 = Hash(n, 1);
+  // h_m = H2(sender_id || "." || message || receiver_id)
+  Hash h2 = hashMessage.withPrefix(to_string(sender_id) + ".");
+  Matrix h_m = h2.hash(message + to_string(receiver_id));
 
-  Matrix h_m = h2.hash(to_string(sender_id) + message.to_string() +
-                       to_string(receiver_id));
+  Matrix F_senderid =
+      Matrix::horizontalConcat(A_prime, *senderMatrix(sender_id));
 
-  Matrix h_senderid = h1.hash(to_string(sender_id));
-  Matrix F_senderid = Matrix::horizontalConcat(A_prime, h_senderid);
+  Matrix sigma = ek_senderid.preimage(h_m, signPool.get());
 
-  // Matrix fake_ek_senderid =
-  // Matrix::generateUniformRandomMatrix(ek_senderid.getRows(),
-  // ek_senderid.getCols());
-
-  Matrix sigma = MP12::fAInversewithoutVariance(F_senderid, ek_senderid, h_m);
-
-  if (F_senderid * sigma != h_m) {
+  if (Matrix::multiplyHNF(F_senderid, sigma) != h_m) {
     throw runtime_error("Enc: signature generation failed");
   }
 
-  // cout << "Enc sigma size = " << sigma.getRows() << " x " << sigma.getCols()
-  //      << endl;
-  // cout << "Enc sigma values: " << endl;
-  // sigma.print();
-
-  // cout << "sigma size = " << sigma.getRows() << " x " << sigma.getCols()
-  //      << endl;
-  // cout << "sigma(0, 0) = " << sigma.get(0, 0) << endl;
-
-  string sigma_bitstring("");
-  for (unsigned int i = 0; i < sigma.getRows(); i++) {
-    sigma_bitstring += Utils::valueToBitString(sigma.get(i, 0), q);
+  // the N encoded bits, message first and then the k-bit coefficients of
+  // the signature
+  const unsigned int slots = params.slots;
+  const unsigned int messageLen = params.messageLen;
+  if (sigma.getRows() * k != params.signatureLen) {
+    throw runtime_error("Enc: the signature does not have SIGNATURE_LEN bits");
   }
-  // cout << "sigma_bitstring = " << sigma_bitstring << endl;
-  if (sigma_bitstring.size() != SIGNATURE_LEN) {
-    throw runtime_error("sigma_bitstring.size() != SIGNATURE_LEN");
+  BitVector bits(slots);
+  for (unsigned int i = 0; i < messageLen; i++) {
+    bits.set(i, message[i] == '1');
   }
+  bits.packCoefficients(messageLen, sigma.rowData(0), sigma.getRows(), k);
 
-  Matrix F_rcv = B1 + h.hash(to_string(receiver_id)) * C1;
-  Matrix F_t = B2 + h.hash(to_string(t)) * C2;
-  Matrix F_rcv_t =
-      Matrix::horizontalConcat(A, Matrix::horizontalConcat(F_rcv, F_t));
+  Matrix F_rcv_t = Matrix::horizontalConcat(
+      A, Matrix::horizontalConcat(*receiverMatrix(receiver_id),
+                                  *epochMatrix(t)));
 
   Matrix s = Matrix::generateUniformRandomMatrix(n, 1);
-  // cout << "s:" << endl;
-  // s.print();
   Matrix R1 = Matrix::generateSignMatrix(2 * m, 2 * m);
   Matrix R2 = Matrix::generateSignMatrix(2 * m, 2 * m);
-  vector<Matrix> x(N);
-  for (unsigned int i = 0; i < N; i++) {
-    x[i] = Matrix::generateDiscreteGaussianMatrix(1, 1, NOISE_SIGMA);
-  }
+  Matrix x =
+      Matrix::generateDiscreteGaussianMatrix(slots, 1, params.noiseSigma);
 
-  Matrix y = Matrix::generateDiscreteGaussianMatrix(2 * m, 1, NOISE_SIGMA);
+  Matrix y =
+      Matrix::generateDiscreteGaussianMatrix(2 * m, 1, params.noiseSigma);
 
   Matrix z1 = R1.transpose() * y;
   Matrix z2 = R2.transpose() * y;
 
-  vector<Matrix> c1;
-  for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-    Matrix message_i(1, 1);
-    message_i.set(0, 0, (message_bitstring[i] - '0') * (BigInt)round(q / 2));
-
-    Matrix c1_i = u[i].transpose() * s + x[i] + message_i;
-    c1.push_back(c1_i);
-
-    // cout << "message_i" << endl;
-    // message_i.print();
-
-    // cout << "u[i]" << endl;
-    // u[i].print();
-
-    // cout << "c1_i" << endl;
-    // c1_i.print();
-
-    // cout << "x[i]" << endl;
-    // x[i].print();
-  }
-
-  // cout << "s" << endl;
-  // s.print();
-
-  for (unsigned int i = MESSAGE_LEN; i < N; i++) {
-    Matrix sigma_i(1, 1);
-    sigma_i.set(
-        0, 0, (sigma_bitstring[i - MESSAGE_LEN] - '0') * (BigInt)round(q / 2));
-    Matrix c1_i = u[i].transpose() * s + x[i] + sigma_i;
-    c1.push_back(c1_i);
-  }
+  // c1 = U^T s + x + round(q / 2) * bits as one GEMV over the rows of U^T,
+  // with the noise and the encoding added as each row is finished
+  Ciphertext ct(slots, 6 * m);
+  BigInt* c1 = ct.c1();
+  const BigInt* s_data = s.rowData(0);
+  const BigInt* x_data = x.rowData(0);
+  const BigInt half = (BigInt)round(q / 2);
+  ThreadPool::instance().parallelFor(
+      0, slots,
+      [&](size_t i) {
+        const BigInt* u_i = U_t.rowData(i);
+        BigInt acc = 0;
+        for (unsigned int j = 0; j < n; j++) {
+          acc += u_i[j] * s_data[j];
+        }
+        c1[i] = (acc + x_data[i] + bits.get(i) * half) % q;
+      },
+      2048);
 
-  Matrix c2 = F_rcv_t.transpose() * s +
+  Matrix c2 = Matrix::transposeMultiplyHNF(F_rcv_t, s) +
               Matrix::verticalConcat(y, Matrix::verticalConcat(z1, z2));
+  copy(c2.rowData(0), c2.rowData(0) + 6 * m, ct.c2());
 
-  return make_pair(c1, c2);
+  return ct;
 }
 
-string IBME::Dec(const vector<pair<Matrix, Matrix>>& dk_receiverid_t,
-                 int receiver_id, int sender_id,
-                 const pair<vector<Matrix>, Matrix>& ct) {
+string IBME::Dec(const DecryptionKey& dk_receiverid_t,
+                 int receiver_id, int sender_id, const Ciphertext& ct) {
+  CryptoContext::Scope active(*context);
   if (sender_id == receiver_id) {
     throw invalid_argument("sender_id == receiver_id");
   }
@@ -336,64 +450,42 @@ string IBME::Dec(const vector<pair<Matrix, Matrix>>& dk_receiverid_t,
   unsigned int k = Matrix::getK();
   unsigned int m = n * k;
 
-  Matrix c20(2 * m, 1);
-  for (unsigned int i = 0; i < 2 * m; i++) {
-    c20.set(i, 0, ct.second.get(i, 0));
-  }
-
-  Matrix c21(2 * m, 1);
-  for (unsigned int i = 0; i < 2 * m; i++) {
-    c21.set(i, 0, ct.second.get(2 * m + i, 0));
+  // omega_i = c1_i - e1_i^T [c20; c21] - e2_i^T [c20; c22] for all slots
+  // at once, with c2 = [c20; c21; c22] used in place
+  const KeyBlock& rk = dk_receiverid_t.getReceiverKey();
+  const KeyBlock& ku = dk_receiverid_t.getKeyUpdate();
+  const unsigned int slots = params.slots;
+  const unsigned int messageLen = params.messageLen;
+  if (rk.getSlots() != slots || ku.getSlots() != slots ||
+      rk.getLength() != 4 * m || ku.getLength() != 4 * m ||
+      ct.getSlots() != slots || ct.getLength() != 6 * m) {
+    throw runtime_error("Dec: the decryption key has the wrong size");
   }
-
-  Matrix c22(2 * m, 1);
-  for (unsigned int i = 0; i < 2 * m; i++) {
-    c22.set(i, 0, ct.second.get(4 * m + i, 0));
+  vector<BigInt> omega(slots);
+  KeyBlock::innerProducts(rk, ku, ct.c2(), omega.data());
+
+  // c1_i - omega_i is close to q / 2 for a 1 bit and close to 0 for a 0 bit
+  const BigInt* c1 = ct.c1();
+  for (unsigned int i = 0; i < slots; i++) {
+    BigInt w = c1[i] - omega[i];
+    omega[i] = w < 0 ? w + q : w;
   }
+  BitVector bits(slots);
+  bits.decodeSlots(0, omega.data(), slots, q);
 
-  vector<Matrix> omega;
-  for (unsigned int i = 0; i < N; i++) {
-    Matrix omega_i = ct.first[i] -
-                     dk_receiverid_t[i].first.transpose() *
-                         Matrix::verticalConcat(c20, c21) -
-                     dk_receiverid_t[i].second.transpose() *
-                         Matrix::verticalConcat(c20, c22);
+  string message = bits.toString(0, messageLen);
 
-    if (omega_i.getRows() != 1 || omega_i.getCols() != 1) {
-      throw runtime_error("omega_i should be a 1x1 matrix");
-    }
-    omega.push_back(omega_i);
-  }
-
-  string m_prime("");
-  for (unsigned int i = 0; i < N; i++) {
-    if (abs(omega[i].get(0, 0) - (BigInt)round(q / 2)) < (BigInt)floor(q / 4)) {
-      m_prime += "1";
-    } else {
-      m_prime += "0";
-    }
-  }
-
-  string message = m_prime.substr(0, MESSAGE_LEN);
-  string sigma_bitstring = m_prime.substr(MESSAGE_LEN, SIGNATURE_LEN);
-
-  // convert every k bits of sigma string to a value
-  Matrix sigma(ceil(SIGNATURE_LEN / k), 1);
-  for (unsigned int i = 0; i < SIGNATURE_LEN; i += k) {
-    string sigma_i = sigma_bitstring.substr(i, k);
-    BigInt value = Utils::bitStringToValue(sigma_i, q);
-    sigma.set(i / k, 0, value);
-  }
+  // convert every k bits of the signature back to a value
+  Matrix sigma(params.signatureLen / k, 1);
+  bits.unpackCoefficients(messageLen, sigma.rowData(0), sigma.getRows(), k);
 
   // verify the signature
-  Hash h1 = Hash(n, m);
-  Hash h2 = Hash(n, 1);
+  Hash h2 = hashMessage.withPrefix(to_string(sender_id) + ".");
+  Matrix h_m = h2.hash(message + to_string(receiver_id));
+  Matrix F_senderid =
+      Matrix::horizontalConcat(A_prime, *senderMatrix(sender_id));
 
-  Matrix h_m = h2.hash(to_string(sender_id) + message + to_string(receiver_id));
-  Matrix h_senderid = h1.hash(to_string(sender_id));
-  Matrix F_senderid = Matrix::horizontalConcat(A_prime, h_senderid);
-
-  if (F_senderid * sigma != h_m) {
+  if (Matrix::multiplyHNF(F_senderid, sigma) != h_m) {
     throw runtime_error("Dec: signature verification failed");
   }
 
@@ -401,6 +493,9 @@ string IBME::Dec(const vector<pair<Matrix, Matrix>>& dk_receiverid_t,
 }
 
 void IBME::KRev(int user_id, int time) {
-  TreeNode* leaf = tree->findithLeaf(user_id);
-  RL.insert(make_pair(leaf, time));
+  if (user_id < 0 || user_id >= static_cast<int>(getCapacity())) {
+    throw invalid_argument(
+        "KRev: invalid user ID, should be between 0 and capacity - 1");
+  }
+  RL.revoke(user_id, time);
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "KeyBlock.hpp"
+
+#include "ParamSet.hpp"
+#include "ThreadPool.hpp"
+
+// Dot product of one packed decryption key row against c, where the shared
+// c0 part is multiplied once by the sum of both keys
+__attribute__((target_clones("avx2", "default"))) static int64_t slotProduct(
+    const int16_t* e1, const int16_t* e2, const int32_t* c, unsigned int half) {
+  int64_t acc = 0;
+  for (unsigned int r = 0; r < half; r++) {
+    acc += static_cast<int64_t>(e1[r] + e2[r]) * c[r];
+  }
+  for (unsigned int r = 0; r < half; r++) {
+    acc += static_cast<int64_t>(e1[half + r]) * c[half + r] +
+           static_cast<int64_t>(e2[half + r]) * c[2 * half + r];
+  }
+  return acc;
+}
+
+KeyBlock::KeyBlock() : slots(0), length(0), purpose(UNTAGGED), owner(-1) {}
+
+KeyBlock::KeyBlock(unsigned int slots, unsigned int length)
+    : slots(slots),
+      length(length),
+      purpose(UNTAGGED),
+      owner(-1),
+      data(static_cast<size_t>(slots) * length) {
+  // Centered entries reach q / 2, which has to fit int16
+  if (Matrix::getModulus() >= 65536) {
+    throw invalid_argument("KeyBlock: modulus does not fit 16-bit entries");
+  }
+}
+
+unsigned int KeyBlock::getSlots() const { return slots; }
+
+unsigned int KeyBlock::getLength() const { return length; }
+
+void KeyBlock::tag(Purpose purpose, int owner) {
+  this->purpose = purpose;
+  this->owner = owner;
+}
+
+KeyBlock::Purpose KeyBlock::getPurpose() const { return purpose; }
+
+int KeyBlock::getOwner() const { return owner; }
+
+const int16_t* KeyBlock::slot(unsigned int i) const {
+  return data.data() + static_cast<size_t>(i) * length;
+}
+
+int16_t* KeyBlock::slot(unsigned int i) {
+  return data.data() + static_cast<size_t>(i) * length;
+}
+
+BigInt KeyBlock::get(unsigned int i, unsigned int r) const {
+  if (i >= slots || r >= length) {
+    throw out_of_range("KeyBlock: index out of range");
+  }
+  BigInt v = slot(i)[r];
+  return v < 0 ? v + Matrix::getModulus() : v;
+}
+
+void KeyBlock::setSlots(unsigned int first, const Matrix& E) {
+  if (E.getRows() != length || first + E.getCols() > slots) {
+    throw invalid_argument("KeyBlock: block does not fit");
+  }
+  BigInt q = Matrix::getModulus();
+  for (unsigned int r = 0; r < length; r++) {
+    const BigInt* row = E.rowData(r);
+    for (unsigned int j = 0; j < E.getCols(); j++) {
+      BigInt v = row[j] > q / 2 ? row[j] - q : row[j];
+      slot(first + j)[r] = static_cast<int16_t>(v);
+    }
+  }
+}
+
+void KeyBlock::innerProducts(const KeyBlock& rk, const KeyBlock& ku,
+                             const BigInt* c, BigInt* out) {
+  if (rk.slots != ku.slots || rk.length != ku.length || rk.length % 2 != 0) {
+    throw invalid_argument("KeyBlock: key blocks do not match");
+  }
+  unsigned int half = rk.length / 2;
+  BigInt q = Matrix::getModulus();
+
+  vector<int32_t> c32(c, c + 3 * static_cast<size_t>(half));
+  withModulus(q, [&](auto modulus) {
+    ThreadPool::instance().parallelFor(
+        0, rk.slots,
+        [&](size_t i) {
+          BigInt v = slotProduct(rk.slot(i), ku.slot(i), c32.data(), half) %
+                     modulus;
+          out[i] = v < 0 ? v + modulus : v;
+        },
+        1024);
+  });
+}
+
+Matrix KeyBlock::getSlot(unsigned int i) const {
+  return getSlotBlock(i, 1);
+}
+
+Matrix KeyBlock::getSlotBlock(unsigned int first, unsigned int count) const {
+  if (first + count > slots) {
+    throw out_of_range("KeyBlock: slots out of range");
+  }
+  BigInt q = Matrix::getModulus();
+  Matrix E(length, count);
+  for (unsigned int j = 0; j < count; j++) {
+    const int16_t* s = slot(first + j);
+    for (unsigned int r = 0; r < length; r++) {
+      E.rowData(r)[j] = s[r] < 0 ? s[r] + q : s[r];
+    }
+  }
+  return E;
+}
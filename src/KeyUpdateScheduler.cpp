@@ -0,0 +1,198 @@
+#include "KeyUpdateScheduler.hpp"
+
+#include <chrono>
+
+struct KeyUpdateScheduler::Job {
+  int t;
+  vector<TreeNode*> nodes;
+  shared_ptr<const Matrix> F_epoch;  // B2 + H(t) * C2, from the cache
+  Matrix F_t;                        // [A | F_epoch]
+  vector<KeyBlock> keys;
+  size_t chunks;  // slot chunks per node
+  size_t tasks;   // nodes.size() * chunks
+
+  atomic<size_t> next{0};
+  atomic<size_t> done{0};
+  bool cancelled = false;  // guarded by the scheduler's mtx
+  bool urgent = false;     // guarded by the scheduler's mtx
+
+  mutex mtx;
+  condition_variable finished;
+  exception_ptr error;
+};
+
+KeyUpdateScheduler::KeyUpdateScheduler(IBME& ibme, size_t threads)
+    : ibme(ibme),
+      paused(false),
+      publishedEpoch(-1),
+      threads(max<size_t>(threads, 1)),
+      pool(this->threads + 1, true) {}
+
+KeyUpdateScheduler::~KeyUpdateScheduler() {
+  {
+    lock_guard<mutex> lock(mtx);
+    if (job) {
+      job->cancelled = true;
+    }
+  }
+  resumed.notify_all();
+}
+
+void KeyUpdateScheduler::prepare(int t) {
+  // The jobs queued below inherit the context of the instance
+  CryptoContext::Scope scope(*ibme.context);
+  if (t < 0) {
+    throw invalid_argument(
+        "KeyUpdateScheduler: t should be greater than or equal to 0");
+  }
+
+  auto next = make_shared<Job>();
+  next->t = t;
+  next->nodes = ibme.tree.KUNodes(ibme.RL, t);
+  next->F_epoch = ibme.epochMatrix(t);
+  next->F_t = Matrix::horizontalConcat(ibme.A, *next->F_epoch);
+  unsigned int length =
+      ibme.trapdoorA.getPreimageRows() + next->F_epoch->getCols();
+  next->keys.assign(next->nodes.size(), KeyBlock(ibme.params.slots, length));
+  next->chunks = (ibme.params.slots + SLOT_CHUNK - 1) / SLOT_CHUNK;
+  next->tasks = next->nodes.size() * next->chunks;
+
+  {
+    lock_guard<mutex> lock(mtx);
+    if (job) {
+      job->cancelled = true;
+    }
+    job = next;
+  }
+  resumed.notify_all();
+
+  for (size_t i = 0; i < threads; i++) {
+    pool.submit([this, next]() { run(*next, false); });
+  }
+}
+
+void KeyUpdateScheduler::pause() {
+  lock_guard<mutex> lock(mtx);
+  paused = true;
+}
+
+void KeyUpdateScheduler::resume() {
+  {
+    lock_guard<mutex> lock(mtx);
+    paused = false;
+  }
+  resumed.notify_all();
+}
+
+bool KeyUpdateScheduler::mayContinue(const Job& job) {
+  // Interactive calls do not signal when they finish, so poll for them
+  unique_lock<mutex> lock(mtx);
+  while (!job.cancelled && !job.urgent &&
+         (paused || ibme.interactivePending())) {
+    resumed.wait_for(lock, chrono::milliseconds(1));
+  }
+  return !job.cancelled;
+}
+
+void KeyUpdateScheduler::run(Job& job, bool foreground) {
+  while (foreground || mayContinue(job)) {
+    size_t task = job.next.fetch_add(1);
+    if (task >= job.tasks) {
+      return;
+    }
+    try {
+      ibme.sampleNodeChunk(job.nodes[task / job.chunks], false,
+                           *job.F_epoch, job.F_t,
+                           (task % job.chunks) * SLOT_CHUNK,
+                           job.keys[task / job.chunks]);
+    } catch (...) {
+      lock_guard<mutex> lock(job.mtx);
+      if (!job.error) {
+        job.error = current_exception();
+      }
+    }
+    if (job.done.fetch_add(1) + 1 == job.tasks) {
+      lock_guard<mutex> lock(job.mtx);
+      job.finished.notify_all();
+    }
+  }
+}
+
+bool KeyUpdateScheduler::isReady(int t) const {
+  lock_guard<mutex> lock(mtx);
+  if (publishedEpoch == t) {
+    return true;
+  }
+  return job && job->t == t && job->done.load() == job->tasks;
+}
+
+shared_ptr<const KeyUpdateScheduler::KeyUpdate> KeyUpdateScheduler::publish(
+    int t) {
+  CryptoContext::Scope scope(*ibme.context);
+  vector<TreeNode*> cover = ibme.tree.KUNodes(ibme.RL, t);
+
+  shared_ptr<Job> current;
+  {
+    lock_guard<mutex> lock(mtx);
+    if (published && publishedEpoch == t) {
+      bool same = published->size() == cover.size();
+      for (size_t i = 0; same && i < cover.size(); i++) {
+        same = (*published)[i].first == cover[i];
+      }
+      if (same) {
+        return published;
+      }
+    }
+    if (job && job->t == t) {
+      current = job;
+      job.reset();
+      // A revocation for t arrived after prepare, the snapshot is stale
+      if (current->nodes != cover) {
+        current->cancelled = true;
+        current.reset();
+      } else {
+        current->urgent = true;
+      }
+    }
+  }
+  resumed.notify_all();
+
+  auto update = make_shared<KeyUpdate>();
+  if (current) {
+    // Finish whatever the background has not done yet on the shared pool
+    ThreadPool& shared = ThreadPool::instance();
+    shared.parallelFor(0, shared.size(),
+                       [&](size_t) { run(*current, true); });
+    unique_lock<mutex> lock(current->mtx);
+    current->finished.wait(lock, [&]() {
+      return current->done.load() == current->tasks;
+    });
+    if (current->error) {
+      rethrow_exception(current->error);
+    }
+    for (size_t i = 0; i < current->nodes.size(); i++) {
+      current->keys[i].tag(KeyBlock::KEY_UPDATE, current->t);
+      update->push_back(make_pair(
+          current->nodes[i],
+          make_shared<const KeyBlock>(std::move(current->keys[i]))));
+    }
+  } else {
+    *update = ibme.KUpdGen(ibme.RL, t);
+  }
+
+  lock_guard<mutex> lock(mtx);
+  published = update;
+  publishedEpoch = t;
+  return published;
+}
+
+shared_ptr<const KeyUpdateScheduler::KeyUpdate> KeyUpdateScheduler::latest()
+    const {
+  lock_guard<mutex> lock(mtx);
+  return published;
+}
+
+int KeyUpdateScheduler::latestEpoch() const {
+  lock_guard<mutex> lock(mtx);
+  return publishedEpoch;
+}
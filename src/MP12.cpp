@@ -1,83 +1,23 @@
 #include "MP12.hpp"
-#include "IB-ME.hpp"
-
-mt19937 MP12::rng = mt19937(random_device()());
-// unsigned int MP12::mean = 0;
-double MP12::stddev = 0;
-Matrix* MP12::List = nullptr;
 
 MP12::MP12() {
-  if (List == nullptr) {
+  if (!CryptoContext::current().hasGadget()) {
     throw invalid_argument("Oracle is not initialized");
   }
 }
 
 MP12::MP12(unsigned int q, double stddev) {
-  if (List != nullptr) {
-    return;
-  }
-  Matrix::setModulus(q);
-  // this->mean = mean;
-  this->stddev = stddev;
-  // cout << "start to generateList(q)" << endl;
-  generateList(q);
+  CryptoContext::current().configure(q, stddev);
 }
 
-double MP12::getStddev() { return stddev; }
+double MP12::getStddev() { return CryptoContext::current().getStddev(); }
 
-int MP12::partition(int low, int high) {
-  BigInt pivot = List->get(0, high);
-  int i = low - 1;
-  for (int j = low; j < high; ++j) {
-    if (List->get(0, j) < pivot) {
-      ++i;
-      List->swapColumns(i, j);
-    }
-  }
-  List->swapColumns(i + 1, high);
-  return i + 1;
+void MP12::setGInverseMethod(GInverseMethod m) {
+  CryptoContext::current().setGInverseMethod(m);
 }
 
-void MP12::quickSort(int low, int high) {
-  if (low < high) {
-    int pi = partition(low, high);
-    quickSort(low, pi - 1);
-    quickSort(pi + 1, high);
-  }
-}
-
-void MP12::generateList(unsigned int q) {
-  BigInt k = ceil(log2(q));
-  BigInt m = k;
-  Matrix* l = new Matrix(m + 1, q * k);
-  List = l;
-  // cout << "new l;" << endl;
-  //(*List).print();
-
-  Matrix X = Matrix::generateDiscreteGaussianMatrix(m, q * k, stddev);
-  // cout << "print X" << endl;
-  // X.print();
-  Matrix g = Matrix(1, m);
-
-  // cout << "g size is 1 x " << m << endl;
-  for (int i = 0; i < m; i++) {
-    g.set(0, i, pow(2, i));
-  }
-  // cout << "print g" << endl;
-  // g.print();
-
-  Matrix u = g * X;
-  // cout << "print u" << endl;
-  // u.print();
-
-  (*l) = Matrix::verticalConcat(u, X);
-  // cout << "print Oracle" << endl;
-  // (*l).print();
-
-  quickSort(0, (*l).getCols() - 1);
-
-  // cout << "print sorted Oracle" << endl;
-  // (*l).print();
+MP12::GInverseMethod MP12::getGInverseMethod() {
+  return CryptoContext::current().getGInverseMethod();
 }
 
 pair<Matrix, Matrix> MP12::trapGen(unsigned int n) {
@@ -107,69 +47,88 @@ pair<Matrix, Matrix> MP12::trapGen(unsigned int n) {
   return result;
 }
 
-unsigned int MP12::binarySearch(BigInt target) {
-  int low = 0;
-  int high = (*List).getCols() - 1;
-
-  while (low <= high) {
-    int mid = low + (high - low) / 2;
-
-    if ((*List).get(0, mid) == target) {
-      // cout << "target is " << target << endl;
-      // cout << "it's index is " << mid << endl;
-      return mid;
-    }
+pair<Matrix, Matrix> MP12::trapGenHNF(unsigned int n) {
+  unsigned int k = Matrix::getK();
+  unsigned int m = n * k;
+  if (m <= n) {
+    throw invalid_argument("trapGenHNF: k must be at least 2");
+  }
 
-    if ((*List).get(0, mid) < target) {
-      low = mid + 1;
-    } else {
-      high = mid - 1;
+  // B = [I | A_bar], so B R = R_top + A_bar R_bottom where R_top holds the
+  // first n rows of R
+  Matrix A_bar = Matrix::generateUniformRandomMatrix(n, m - n);
+  Matrix R = Matrix::generateDiscreteGaussianMatrix(m, m, MP12().getStddev());
+  Matrix BR(n, m);
+  Matrix R_bottom(m - n, m);
+  for (unsigned int i = 0; i < m - n; i++) {
+    copy(R.rowData(n + i), R.rowData(n + i) + m, R_bottom.rowData(i));
+  }
+  Matrix::multiplyInto(A_bar, R_bottom, BR);
+  for (unsigned int i = 0; i < n; i++) {
+    for (unsigned int j = 0; j < m; j++) {
+      BR.set(i, j, BR.get(i, j) + R.get(i, j));
     }
   }
 
-  throw invalid_argument("No such u vectors");
+  Matrix G_BR = Matrix::generateGadgetMatrix(n) - BR;
+  return make_pair(Matrix::horizontalConcat(A_bar, G_BR), R);
 }
 
-Matrix MP12::O(BigInt u) {
-  vector<Matrix> targV;
-  unsigned int target = binarySearch(u);
-
-  unsigned int i = target;
-  // cout<<"target int i="<<i<<endl;
-  unsigned int resRows = (*List).getRows();
-  // cout << "O cout resRows:" << resRows << endl;
-  Matrix res(resRows - 1, 1);
-
-  while (i >= 0 && (*List).get(0, i) == u) {
-    // cout<<"i-- i="<<i<<endl;
-    targV.push_back((*List).getColVector(i));
-    if (i == 0) break;
-    --i;
-  }
-  i = target + 1;
-  while (i < (*List).getCols() && (*List).get(0, i) == u) {
-    // cout<<"i++ i="<<i<<endl;
-    targV.push_back((*List).getColVector(i));
-    ++i;
+void MP12::oracle(BigInt u, BigInt* x) {
+  CryptoContext& context = CryptoContext::current();
+  const CryptoContext::OracleTable& table = context.getOracleTable();
+  BigInt q = context.getModulus();
+  u = (u % q + q) % q;
+
+  unsigned int begin = table.offsets[u];
+  unsigned int end = table.offsets[u + 1];
+  if (begin == end) {
+    // No sample with this residue was drawn, sample it directly instead
+    context.getGadget().sample(u, x, context.rng());
+    return;
   }
-  unsigned int numAns = targV.size();
-  // cout<<"end find targV"<<endl;
 
-  unsigned int random_number = 0;
-  if (numAns != 1) {
-    uniform_int_distribution<int> distribution(0, numAns - 1);
-    random_number = distribution(rng);
+  unsigned int pick = begin;
+  if (end - begin > 1) {
+    uniform_int_distribution<unsigned int> distribution(begin, end - 1);
+    pick = distribution(context.rng());
   }
+  const BigInt* column =
+      table.samples.data() + static_cast<size_t>(pick) * table.k;
+  copy(column, column + table.k, x);
+}
+
+Matrix MP12::O(BigInt u) {
+  unsigned int k = Matrix::getK();
+  BigInt x[64];
+  oracle(u, x);
 
-  for (int i = 0; i < resRows - 1; i++) {
-    // cout<<"set "<<"i ="<<i<<"random number is "<<random_number<<endl;
-    res.set(i, 0, targV[random_number].get(i + 1, 0));
+  Matrix res(k, 1);
+  for (unsigned int i = 0; i < k; i++) {
+    res.set(i, 0, x[i]);
   }
-  // cout<<"O res is :"<<endl;
-  // res.print();
   return res;
 }
 
+void MP12::gInverse(BigInt u, BigInt* x) {
+  CryptoContext& context = CryptoContext::current();
+  if (context.getGInverseMethod() == DIRECT) {
+    context.getGadget().sample(u, x, context.rng());
+  } else {
+    MP12().oracle(u, x);
+  }
+}
+
+void MP12::gInverse(BigInt u, const BigInt* p, BigInt* x) {
+  CryptoContext& context = CryptoContext::current();
+  context.getGadget().sampleWithPerturbation(u, p, x, context.rng());
+}
+
+void MP12::gadgetPerturbation(BigInt* p) {
+  CryptoContext& context = CryptoContext::current();
+  context.getGadget().perturb(p, context.rng());
+}
+
 Matrix MP12::fGInverse(Matrix u) {
   unsigned int n = u.getRows();
   unsigned int k = Matrix::getK();
@@ -177,14 +136,11 @@ Matrix MP12::fGInverse(Matrix u) {
   // cout << "fGInverse n, k=" << n << "," << k << endl;
   Matrix x(n * k, 1);
 
+  BigInt x_i[64];
   for (unsigned int i = 0; i < n; i++) {
-    BigInt u_i = u.get(i, 0);
-    Matrix x_i = O(u_i);
-    // cout<<"u_i="<<u_i<<endl;
-    // cout<<"x_i="<<endl;
-    // x_i.print();
+    gInverse(u.get(i, 0), x_i);
     for (unsigned int kk = 0; kk < k; kk++) {
-      x.set(i * k + kk, 0, x_i.get(kk, 0));
+      x.set(i * k + kk, 0, x_i[kk]);
     }
   }
   // cout<<"fGInverse print x"<<endl;
@@ -192,12 +148,62 @@ Matrix MP12::fGInverse(Matrix u) {
   return x;
 }
 
-Matrix MP12::fAInversewithoutVariance(Matrix A, Matrix T_A, Matrix u) {
+void MP12::fGInverseBatch(const Matrix& U, Matrix& Z) {
+  unsigned int n = U.getRows();
+  unsigned int k = Matrix::getK();
+  if (Z.getRows() != n * k || Z.getCols() != U.getCols()) {
+    throw invalid_argument("fGInverseBatch: Z must be nk x cols(U)");
+  }
+
+  // Build the table before the helpers ask for it
+  CryptoContext& context = CryptoContext::current();
+  if (context.getGInverseMethod() == ORACLE) {
+    context.getOracleTable();
+  }
+
+  // Columns are independent, each one is sampled on the pool
+  ThreadPool::instance().parallelFor(
+      0, U.getCols(),
+      [&](size_t j) {
+        BigInt x_i[64];
+        for (unsigned int i = 0; i < n; i++) {
+          gInverse(U.get(i, j), x_i);
+          for (unsigned int kk = 0; kk < k; kk++) {
+            Z.set(i * k + kk, j, x_i[kk]);
+          }
+        }
+      },
+      16);
+}
+
+void MP12::fAInverseBatch(const Matrix& T_A, const Matrix& U, Matrix& out) {
+  unsigned int m = T_A.getRows();
   unsigned int nk = T_A.getCols();
-  Matrix z = MP12().fGInverse(u);
-  Matrix I = Matrix::generateIdentityMatrix(nk);
-  Matrix R_I = Matrix::verticalConcat(T_A, I);
-  return R_I * z;
+  if (U.getRows() * Matrix::getK() != nk) {
+    throw invalid_argument("fAInverseBatch: U does not match the trapdoor");
+  }
+  if (out.getRows() != m + nk || out.getCols() != U.getCols()) {
+    throw invalid_argument("fAInverseBatch: out must be (m + nk) x cols(U)");
+  }
+
+  // out = [T_A; I] * Z, the identity block is just a copy of Z
+  Matrix Z(nk, U.getCols());
+  MP12().fGInverseBatch(U, Z);
+  const unsigned int band = 64;
+  ThreadPool::instance().parallelFor(0, (m + band - 1) / band, [&](size_t b) {
+    unsigned int first = b * band;
+    Matrix::multiplyInto(T_A, Z, out, 0, first, min(m, first + band));
+  });
+  for (unsigned int i = 0; i < nk; i++) {
+    copy(Z.rowData(i), Z.rowData(i) + Z.getCols(), out.rowData(m + i));
+  }
+}
+
+Matrix MP12::fAInversewithoutVariance(const Matrix& /* A */, const Matrix& T_A,
+                                      const Matrix& u) {
+  Matrix x(T_A.getRows() + T_A.getCols(), u.getCols());
+  fAInverseBatch(T_A, u, x);
+  return x;
 }
 
 Matrix MP12::fAInverse(Matrix A, Matrix T_A, Matrix u) {
@@ -209,7 +215,7 @@ Matrix MP12::fAInverse(Matrix A, Matrix T_A, Matrix u) {
   Matrix I = Matrix::generateIdentityMatrix(n * k);
   Matrix RIc = Matrix::verticalConcat(R, I);
   Matrix x = RIc * z;
-  BigInt s = stddev;
+  BigInt s = MP12().getStddev();
 
   Matrix Iss = Matrix::multiplyByInteger(I, s * s);
   cout << "fAInverse Iss:" << endl;
@@ -232,7 +238,6 @@ void MP12::testmp() {
   unsigned int q = 7;
   unsigned int stddev = 2;
   MP12 MP(q, stddev);
-  unsigned int tar = MP.binarySearch(1);
 
   cout << "O" << endl;
   Matrix Ans = MP.O(1);
@@ -306,17 +311,24 @@ pair<Matrix, Matrix> MP12::delTrap(const Matrix& A, const Matrix& T_A,
   Matrix G = Matrix::generateGadgetMatrix(A.getRows());
   Matrix target = G - A1;
 
-  Matrix T_A_prime =
-      fAInversewithoutVariance(A_prime, T_A, target.getColVector(0));
-  for (size_t i = 1; i < target.getCols(); i++) {
-    Matrix u = target.getColVector(i);
-    Matrix T_A_prime_col = fAInversewithoutVariance(A_prime, T_A, u);
-    T_A_prime = Matrix::horizontalConcat(T_A_prime, T_A_prime_col);
-  }
+  // Solve all columns of the target at once into the final trapdoor
+  Matrix T_A_prime(T_A.getRows() + T_A.getCols(), target.getCols());
+  fAInverseBatch(T_A, target, T_A_prime);
 
   return make_pair(A_prime, T_A_prime);
 }
 
+pair<Matrix, Trapdoor> MP12::delTrap(const Matrix& A, const Trapdoor& T_A,
+                                     const Matrix& A1) {
+  Matrix A_prime = Matrix::horizontalConcat(A, A1);
+  Matrix target = Matrix::generateGadgetMatrix(A.getRows()) - A1;
+
+  Matrix T_A_prime(T_A.getPreimageRows(), target.getCols());
+  T_A.preimage(target, T_A_prime);
+
+  return make_pair(A_prime, Trapdoor(T_A_prime));
+}
+
 void MP12::testDelTrap() {
   unsigned int n = 4;
   unsigned int q = 71;
@@ -358,18 +370,85 @@ void MP12::testDelTrap() {
   res.print();
 }
 
+Matrix MP12::SampleLeftBatch(const Matrix& A, const Matrix& M1,
+                             const Trapdoor& trapdoorA, const Matrix& U,
+                             PerturbationPool* pool) {
+  unsigned int n = A.getRows();
+  unsigned int m1 = M1.getCols();
+  unsigned int width = U.getCols();
+  if (M1.getRows() != n || U.getRows() != n) {
+    throw invalid_argument("SampleLeftBatch: A, M1 and U must have n rows");
+  }
+  // A is the part after I_n, so preimages under [I | A] have n + cols(A)
+  // entries
+  if (n + A.getCols() != trapdoorA.getPreimageRows()) {
+    throw invalid_argument("SampleLeftBatch: trapdoor does not match A");
+  }
+  if (pool != nullptr && (pool->getExtraLength() != m1 ||
+                          pool->getGadgetLength() != trapdoorA.getCols())) {
+    throw invalid_argument(
+        "SampleLeftBatch: pool does not match M1 and the trapdoor");
+  }
+
+  // E2 for all targets at once, from the pool when there is one
+  Matrix E2(m1, width);
+  vector<vector<BigInt>> items;
+  vector<const BigInt*> perturbations(width, nullptr);
+  if (pool != nullptr) {
+    items.resize(width);
+    for (unsigned int j = 0; j < width; j++) {
+      pool->take(items[j]);
+      const BigInt* extra = items[j].data() + pool->getGadgetLength();
+      for (unsigned int i = 0; i < m1; i++) {
+        E2.set(i, j, extra[i]);
+      }
+      perturbations[j] = items[j].data();
+    }
+  } else {
+    // sample width of the context, the sigma of its IBME instance
+    double stddev = CryptoContext::current().getStddev();
+    E2 = Matrix::generateDiscreteGaussianMatrix(m1, width, stddev);
+  }
+
+  // One GEMM for the corrected targets and one batched trapdoor preimage
+  Matrix Y = U - M1 * E2;
+  Matrix E1(trapdoorA.getPreimageRows(), width);
+  trapdoorA.preimage(Y, E1, perturbations.data());
+
+  return Matrix::verticalConcat(E1, E2);
+}
+
 Matrix MP12::SampleLeft(const Matrix& A, const Matrix& M1,
-                        const Matrix& trapdoorA, const Matrix& u) {
+                        const Trapdoor& trapdoorA, const Matrix& u,
+                        PerturbationPool* pool) {
   unsigned int n = A.getRows();
   unsigned int m = A.getCols();
   unsigned int m1 = M1.getCols();
 
-  Matrix e2 = Matrix::generateDiscreteGaussianMatrix(m1, 1, SIGMA);
+  if (pool != nullptr && pool->getExtraLength() != m1) {
+    throw invalid_argument("SampleLeft: pool does not match M1");
+  }
+  // With a pool, only the correction of the target and the gadget inversion
+  // are left to do here; an empty pool computes the item inline
+  vector<BigInt> item;
+  Matrix e2(m1, 1);
+  if (pool != nullptr) {
+    pool->take(item);
+    const BigInt* extra = item.data() + pool->getGadgetLength();
+    for (unsigned int i = 0; i < m1; i++) {
+      e2.set(i, 0, extra[i]);
+    }
+  } else {
+    // sample width of the context, the sigma of its IBME instance
+    double stddev = CryptoContext::current().getStddev();
+    e2 = Matrix::generateDiscreteGaussianMatrix(m1, 1, stddev);
+  }
   // cout << "M1 size is " << M1.getRows() << " x " << M1.getCols() << endl;
   // cout << "e2 size is " << e2.getRows() << " x " << e2.getCols() << endl;
   Matrix y = u - M1 * e2;
 
-  Matrix e1 = fAInversewithoutVariance(A, trapdoorA, y);
+  Matrix e1 = pool != nullptr ? trapdoorA.preimage(y, item.data())
+                              : trapdoorA.preimage(y);
   // cout << "A size is " << A.getRows() << " x " << A.getCols() << endl;
   // cout << "e1 size is " << e1.getRows() << " x " << e1.getCols() << endl;
 
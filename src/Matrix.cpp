@@ -1,36 +1,54 @@
 #include "Matrix.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <stdexcept>
 
-// Initialize static members
-mt19937 Matrix::rand_generator(static_cast<unsigned>(time(nullptr)));
-unsigned int Matrix::k = 0;
-BigInt Matrix::modulus = 0;
+#include "ParamSet.hpp"
+
+// Row update of the GEMM kernel, out[j] += a * b[j]. Entries are below 2^32,
+// so the products map onto 32 x 32 -> 64 bit vector multiplies; cloned for
+// AVX2 and picked at load time.
+__attribute__((target_clones("avx2", "default"))) static void axpyRow(
+    BigInt* out, BigInt a, const BigInt* b, unsigned int n) {
+  uint64_t a32 = static_cast<uint32_t>(a);
+  for (unsigned int j = 0; j < n; ++j) {
+    out[j] += static_cast<BigInt>(a32 * static_cast<uint32_t>(b[j]));
+  }
+}
+
+// Modulus is BigInt or, for the named parameter sets, an integral_constant,
+// in which case the reduction compiles to a multiply and shift
+template <class Modulus>
+static void reduceRow(BigInt* row, unsigned int n, Modulus q) {
+  for (unsigned int j = 0; j < n; ++j) {
+    row[j] %= q;
+  }
+}
 
 // Default Constructor
-Matrix::Matrix() {}
+Matrix::Matrix() : rows(0), cols(0) {}
 
 // Constructor
 Matrix::Matrix(unsigned int r, unsigned int c)
-    : rows(r), cols(c), data(r, vector<BigInt>(c)) {}
+    : data(static_cast<size_t>(r) * c), rows(r), cols(c) {}
 
 // Get size information
 unsigned int Matrix::getRows() const { return rows; }
 
 unsigned int Matrix::getCols() const { return cols; }
 
-unsigned int Matrix::getK() { return k; }
+unsigned int Matrix::getK() { return CryptoContext::current().getK(); }
 
-// Function to set the global modulus
+// Function to set the modulus of the current CryptoContext
 void Matrix::setModulus(const BigInt& mod) {
-  modulus = mod;
-  k = ceil(log2(modulus));
+  CryptoContext::current().setModulus(mod);
 }
 
-BigInt Matrix::getModulus() { return modulus; }
+BigInt Matrix::getModulus() { return CryptoContext::current().getModulus(); }
 
 // Method to swap two columns
 void Matrix::swapColumns(const unsigned int col1, const unsigned int col2) {
@@ -38,7 +56,7 @@ void Matrix::swapColumns(const unsigned int col1, const unsigned int col2) {
     throw out_of_range("Column index out of range");
   }
   for (unsigned int i = 0; i < rows; ++i) {
-    swap(data[i][col1], data[i][col2]);
+    swap(data[i * cols + col1], data[i * cols + col2]);
   }
 }
 
@@ -46,7 +64,19 @@ void Matrix::swapColumns(const unsigned int col1, const unsigned int col2) {
 Matrix Matrix::getColVector(const unsigned int col) const {
   Matrix res(rows, 1);
   for (unsigned int i = 0; i < rows; ++i) {
-    res.set(i, 0, data[i][col]);
+    res.set(i, 0, data[i * cols + col]);
+  }
+  return res;
+}
+
+// Function to get the columns [first, first + count) as a matrix
+Matrix Matrix::getColBlock(unsigned int first, unsigned int count) const {
+  if (first + count > cols) {
+    throw out_of_range("getColBlock: columns out of range");
+  }
+  Matrix res(rows, count);
+  for (unsigned int i = 0; i < rows; ++i) {
+    copy(rowData(i) + first, rowData(i) + first + count, res.rowData(i));
   }
   return res;
 }
@@ -54,8 +84,10 @@ Matrix Matrix::getColVector(const unsigned int col) const {
 // Function to set a value in the matrix
 void Matrix::set(const unsigned int r, const unsigned int c,
                  const BigInt& value) {
+  BigInt modulus = getModulus();
   if (r < rows && c < cols) {
-    data[r][c] = (value % modulus + modulus) % modulus;
+    data[static_cast<size_t>(r) * cols + c] =
+        (value % modulus + modulus) % modulus;
   } else {
     throw out_of_range("set Index out of range");
   }
@@ -64,39 +96,55 @@ void Matrix::set(const unsigned int r, const unsigned int c,
 // Function to get a value from the matrix
 BigInt Matrix::get(unsigned int r, unsigned int c) const {
   if (r < rows && c < cols) {
-    return data[r][c];
+    return data[static_cast<size_t>(r) * cols + c];
   } else {
     // cout<<"int put r,c="<<r<<" "<<c<<endl;
     throw out_of_range("get Index out of range");
   }
 }
 
+// Function to get a pointer to the storage of a row
+BigInt* Matrix::rowData(unsigned int r) {
+  if (r >= rows) {
+    throw out_of_range("rowData Index out of range");
+  }
+  return data.data() + static_cast<size_t>(r) * cols;
+}
+
+const BigInt* Matrix::rowData(unsigned int r) const {
+  if (r >= rows) {
+    throw out_of_range("rowData Index out of range");
+  }
+  return data.data() + static_cast<size_t>(r) * cols;
+}
+
 // Function to add two matrices
 Matrix Matrix::operator+(const Matrix& other) const {
+  BigInt modulus = getModulus();
   if (rows != other.rows || cols != other.cols) {
     throw invalid_argument(
         "Matrices must have the same dimensions for addition");
   }
+  // Both operands are reduced, so one conditional subtraction is enough
   Matrix result(rows, cols);
-  for (unsigned int i = 0; i < rows; ++i) {
-    for (unsigned int j = 0; j < cols; ++j) {
-      result.set(i, j, this->get(i, j) + other.get(i, j));
-    }
+  for (size_t i = 0; i < data.size(); ++i) {
+    BigInt sum = data[i] + other.data[i];
+    result.data[i] = sum >= modulus ? sum - modulus : sum;
   }
   return result;
 }
 
 // Function to subtract two matrices
 Matrix Matrix::operator-(const Matrix& other) const {
+  BigInt modulus = getModulus();
   if (rows != other.rows || cols != other.cols) {
     throw invalid_argument(
         "Matrices must have the same dimensions for subtraction");
   }
   Matrix result(rows, cols);
-  for (unsigned int i = 0; i < rows; ++i) {
-    for (unsigned int j = 0; j < cols; ++j) {
-      result.set(i, j, this->get(i, j) - other.get(i, j));
-    }
+  for (size_t i = 0; i < data.size(); ++i) {
+    BigInt diff = data[i] - other.data[i];
+    result.data[i] = diff < 0 ? diff + modulus : diff;
   }
   return result;
 }
@@ -107,15 +155,121 @@ Matrix Matrix::operator*(const Matrix& other) const {
     throw invalid_argument("Matrices cannot be multiplied");
   }
   Matrix result(rows, other.cols);
-  for (unsigned int i = 0; i < rows; ++i) {
-    for (unsigned int j = 0; j < other.cols; ++j) {
-      BigInt sum = 0;
-      for (unsigned int k = 0; k < cols; ++k) {
-        sum = sum + (this->get(i, k) * other.get(k, j));
+  multiplyInto(*this, other, result, 0);
+  return result;
+}
+
+// Blocked GEMM C[first..last) = A[first..last) * B over raw row-major
+// buffers with leading dimensions lda, ldb and ldc, tiled over B so a tile
+// fits in L2. Entries of A and B are in [0, q), so products are accumulated
+// unreduced and only folded mod q when the next k-tile could overflow an
+// int64.
+template <class Modulus>
+static void blockedProductMod(const BigInt* A, size_t lda, const BigInt* B,
+                              size_t ldb, BigInt* C, size_t ldc,
+                              unsigned int first, unsigned int last,
+                              unsigned int inner, unsigned int width,
+                              Modulus q) {
+  const unsigned int kTile = 128;
+  const unsigned int jTile = 512;
+  const uint64_t maxProduct =
+      static_cast<uint64_t>(q - 1) * static_cast<uint64_t>(q - 1);
+  const uint64_t headroom = static_cast<uint64_t>(INT64_MAX) - q;
+  const uint64_t safeTerms =
+      maxProduct == 0 ? UINT64_MAX : headroom / maxProduct;
+  if (safeTerms == 0 || q > (BigInt(1) << 32)) {
+    throw invalid_argument("Matrix product: modulus is too large");
+  }
+
+  for (unsigned int i = first; i < last; ++i) {
+    fill(C + i * ldc, C + i * ldc + width, 0);
+  }
+
+  for (unsigned int j0 = 0; j0 < width; j0 += jTile) {
+    unsigned int jn = min(jTile, width - j0);
+    uint64_t pending = 0;
+    for (unsigned int k0 = 0; k0 < inner; k0 += kTile) {
+      unsigned int k1 = min(inner, k0 + kTile);
+      bool fold = pending + (k1 - k0) > safeTerms;
+      for (unsigned int i = first; i < last; ++i) {
+        BigInt* c = C + i * ldc + j0;
+        if (fold) {
+          reduceRow(c, jn, q);
+        }
+        const BigInt* a = A + i * lda;
+        for (unsigned int kk = k0; kk < k1; ++kk) {
+          if (a[kk] != 0) {
+            axpyRow(c, a[kk], B + kk * ldb + j0, jn);
+          }
+        }
       }
-      result.set(i, j, sum);
+      pending = fold ? (k1 - k0) : pending + (k1 - k0);
+    }
+    for (unsigned int i = first; i < last; ++i) {
+      reduceRow(C + i * ldc + j0, jn, q);
     }
   }
+}
+
+static void blockedProduct(const BigInt* A, size_t lda, const BigInt* B,
+                           size_t ldb, BigInt* C, size_t ldc,
+                           unsigned int first, unsigned int last,
+                           unsigned int inner, unsigned int width, BigInt q) {
+  withModulus(q, [&](auto modulus) {
+    blockedProductMod(A, lda, B, ldb, C, ldc, first, last, inner, width,
+                      modulus);
+  });
+}
+
+// Function to multiply two matrices into rows of a preallocated matrix
+void Matrix::multiplyInto(const Matrix& A, const Matrix& B, Matrix& out,
+                          unsigned int rowOffset, unsigned int firstRow,
+                          unsigned int lastRow) {
+  BigInt modulus = getModulus();
+  lastRow = min(lastRow, A.rows);
+  if (A.cols != B.rows) {
+    throw invalid_argument("Matrices cannot be multiplied");
+  }
+  if (out.cols != B.cols || rowOffset + A.rows > out.rows) {
+    throw invalid_argument("multiplyInto: output block has the wrong size");
+  }
+  blockedProduct(A.data.data(), A.cols, B.data.data(), B.cols,
+                 out.rowData(rowOffset), out.cols, firstRow, lastRow, A.cols,
+                 B.cols, modulus);
+}
+
+// Function to multiply [I | tail] * x, without touching the identity block
+Matrix Matrix::multiplyHNF(const Matrix& tail, const Matrix& x) {
+  BigInt modulus = getModulus();
+  unsigned int n = tail.rows;
+  if (x.rows != n + tail.cols) {
+    throw invalid_argument("multiplyHNF: Matrices cannot be multiplied");
+  }
+  Matrix result(n, x.cols);
+  blockedProduct(tail.data.data(), tail.cols, x.rowData(n), x.cols,
+                 result.rowData(0), result.cols, 0, n, tail.cols, x.cols,
+                 modulus);
+  for (size_t i = 0; i < result.data.size(); ++i) {
+    BigInt sum = result.data[i] + x.data[i];
+    result.data[i] = sum >= modulus ? sum - modulus : sum;
+  }
+  return result;
+}
+
+// Function to multiply [I | tail]^T * s = [s; tail^T * s]
+Matrix Matrix::transposeMultiplyHNF(const Matrix& tail, const Matrix& s) {
+  BigInt modulus = getModulus();
+  unsigned int n = tail.rows;
+  if (s.rows != n) {
+    throw invalid_argument(
+        "transposeMultiplyHNF: Matrices cannot be multiplied");
+  }
+  Matrix result(n + tail.cols, s.cols);
+  copy(s.data.begin(), s.data.end(), result.data.begin());
+  Matrix tailT = tail.transpose();
+  blockedProduct(tailT.data.data(), tailT.cols, s.data.data(), s.cols,
+                 result.rowData(n), result.cols, 0, tailT.rows, n, s.cols,
+                 modulus);
   return result;
 }
 
@@ -126,7 +280,7 @@ bool Matrix::operator==(const Matrix& other) const {
   }
   for (unsigned int i = 0; i < rows; ++i) {
     for (unsigned int j = 0; j < cols; ++j) {
-      if (data[i][j] != other.data[i][j]) {
+      if (data[i * cols + j] != other.data[i * other.cols + j]) {
         return false;
       }
     }
@@ -144,7 +298,7 @@ Matrix Matrix::multiplyByInteger(const Matrix& in, const BigInt& num) {
   Matrix result(rows, cols);
   for (unsigned int i = 0; i < rows; ++i) {
     for (unsigned int j = 0; j < cols; ++j) {
-      result.data[i][j] = in.get(i, j) * num;
+      result.set(i, j, in.get(i, j) * num);
     }
   }
   return result;
@@ -156,7 +310,7 @@ void Matrix::print() const {
   cout << line << endl;
   for (unsigned int i = 0; i < rows; ++i) {
     for (unsigned int j = 0; j < cols; ++j) {
-      cout << setw(10) << data[i][j] << " ";
+      cout << setw(10) << data[i * cols + j] << " ";
     }
     cout << endl;
   }
@@ -166,6 +320,7 @@ void Matrix::print() const {
 // Function to generate a discrete Gaussian matrix
 Matrix Matrix::generateDiscreteGaussianMatrix(unsigned int r, unsigned int c,
                                               double stddev) {
+  BigInt modulus = getModulus();
   DiscreteGaussianSampler sampler(stddev, modulus);
   Matrix result(r, c);
   for (unsigned int i = 0; i < r; ++i) {
@@ -179,7 +334,7 @@ Matrix Matrix::generateDiscreteGaussianMatrix(unsigned int r, unsigned int c,
 
 // Function to generate a matrix of 1 and -1
 Matrix Matrix::generateSignMatrix(unsigned int r, unsigned int c) {
-  // Initialize the random number generator
+  mt19937& rng = CryptoContext::current().rng();
   uniform_int_distribution<int> dist(0, 1);  // distribution to generate 0 or 1
 
   // Create the m x m matrix
@@ -188,7 +343,7 @@ Matrix Matrix::generateSignMatrix(unsigned int r, unsigned int c) {
   for (int i = 0; i < r; ++i) {
     for (int j = 0; j < c; ++j) {
       // Generate either -1 or 1
-      matrix.set(i, j, dist(rand_generator) == 0 ? -1 : 1);
+      matrix.set(i, j, dist(rng) == 0 ? -1 : 1);
     }
   }
 
@@ -197,6 +352,7 @@ Matrix Matrix::generateSignMatrix(unsigned int r, unsigned int c) {
 
 // Function to generate a random matrix
 Matrix Matrix::generateUniformRandomMatrix(unsigned int r, unsigned int c) {
+  BigInt modulus = getModulus();
   DiscreteUniformSampler sampler(modulus);
   Matrix result(r, c);
   for (unsigned int i = 0; i < r; ++i) {
@@ -210,10 +366,17 @@ Matrix Matrix::generateUniformRandomMatrix(unsigned int r, unsigned int c) {
 
 // Function to transpose the matrix
 Matrix Matrix::transpose() const {
+  // Transposed in square tiles so both sides stay in cache
+  const unsigned int tile = 32;
   Matrix result(cols, rows);
-  for (unsigned int i = 0; i < rows; ++i) {
-    for (unsigned int j = 0; j < cols; ++j) {
-      result.set(j, i, data[i][j]);
+  for (unsigned int i0 = 0; i0 < rows; i0 += tile) {
+    for (unsigned int j0 = 0; j0 < cols; j0 += tile) {
+      for (unsigned int i = i0; i < min(rows, i0 + tile); ++i) {
+        for (unsigned int j = j0; j < min(cols, j0 + tile); ++j) {
+          result.data[static_cast<size_t>(j) * rows + i] =
+              data[static_cast<size_t>(i) * cols + j];
+        }
+      }
     }
   }
   return result;
@@ -224,20 +387,24 @@ unsigned int Matrix::rank() const {
   Matrix temp(*this);  // Make a copy of the matrix
   unsigned int rank = 0;
   for (unsigned int row = 0; row < rows; ++row) {
-    if (temp.data[row][row] != 0) {
+    if (temp.data[row * temp.cols + row] != 0) {
       for (unsigned int col = 0; col < cols; ++col) {
         if (col != row) {
-          BigInt ratio = temp.data[col][row] / temp.data[row][row];
+          BigInt ratio = temp.data[col * temp.cols + row] /
+                         temp.data[row * temp.cols + row];
           for (unsigned int k = 0; k < cols; ++k) {
-            temp.data[col][k] = temp.data[col][k] - ratio * temp.data[row][k];
+            temp.data[col * temp.cols + k] =
+                temp.data[col * temp.cols + k] -
+                ratio * temp.data[row * temp.cols + k];
           }
         }
       }
     } else {
       bool reduce = true;
       for (unsigned int i = row + 1; i < rows; ++i) {
-        if (temp.data[i][row] != 0) {
-          swap(temp.data[row], temp.data[i]);
+        if (temp.data[i * temp.cols + row] != 0) {
+          swap_ranges(temp.rowData(row), temp.rowData(row) + cols,
+                      temp.rowData(i));
           reduce = false;
           break;
         }
@@ -245,7 +412,8 @@ unsigned int Matrix::rank() const {
       if (reduce) {
         --rank;
         for (unsigned int i = 0; i < rows; ++i) {
-          temp.data[i][row] = temp.data[i][cols - 1];
+          temp.data[i * temp.cols + row] =
+              temp.data[i * temp.cols + (cols - 1)];
         }
       }
     }
@@ -256,6 +424,7 @@ unsigned int Matrix::rank() const {
 
 // Function to generate a gadget matrix
 Matrix Matrix::generateGadgetMatrix(unsigned int n) {
+  unsigned int k = getK();
   Matrix result(n, n * k);
   for (unsigned int i = 0; i < n; ++i) {
     for (unsigned int j = 0; j < n * k; j += k) {
@@ -295,16 +464,8 @@ Matrix Matrix::verticalConcat(const Matrix& A, const Matrix& B) {
         "Matrix column counts do not match for vertical concatenation.");
   }
   Matrix result(A.rows + B.rows, A.cols);
-  for (unsigned int i = 0; i < A.rows; ++i) {
-    for (unsigned int j = 0; j < A.cols; ++j) {
-      result.data[i][j] = A.data[i][j];
-    }
-  }
-  for (unsigned int i = 0; i < B.rows; ++i) {
-    for (unsigned int j = 0; j < B.cols; ++j) {
-      result.data[i + A.rows][j] = B.data[i][j];
-    }
-  }
+  copy(A.data.begin(), A.data.end(), result.data.begin());
+  copy(B.data.begin(), B.data.end(), result.data.begin() + A.data.size());
   return result;
 }
 
@@ -316,14 +477,9 @@ Matrix Matrix::horizontalConcat(const Matrix& A, const Matrix& B) {
   }
   Matrix result(A.rows, A.cols + B.cols);
   for (unsigned int i = 0; i < A.rows; ++i) {
-    for (unsigned int j = 0; j < A.cols; ++j) {
-      result.data[i][j] = A.data[i][j];
-    }
-  }
-  for (unsigned int i = 0; i < B.rows; ++i) {
-    for (unsigned int j = 0; j < B.cols; ++j) {
-      result.data[i][j + A.cols] = B.data[i][j];
-    }
+    BigInt* row = result.rowData(i);
+    copy(A.rowData(i), A.rowData(i) + A.cols, row);
+    copy(B.rowData(i), B.rowData(i) + B.cols, row + A.cols);
   }
   return result;
 }
@@ -336,7 +492,7 @@ bool Matrix::isPositiveDefinite() const {
   }
 
   for (unsigned int i = 1; i <= rows; ++i) {
-    if (data[i][i] == 0) {
+    if (data[i * cols + i] == 0) {
       throw invalid_argument(
           "The principal diagonal elements of the matrix cannot be 0.");
     }
@@ -346,6 +502,7 @@ bool Matrix::isPositiveDefinite() const {
 
 // Function to perform Cholesky Decomposition
 Matrix Matrix::CholeskyDecomposition(const Matrix& in) {
+  BigInt modulus = getModulus();
   Matrix result(in.rows, in.cols);
   if (in.isPositiveDefinite()) {
     for (unsigned int i = 0; i < in.rows; ++i) {
@@ -379,7 +536,7 @@ string Matrix::toString() const {
   string result;
   for (unsigned int i = 0; i < rows; ++i) {
     for (unsigned int j = 0; j < cols; ++j) {
-      result += to_string(data[i][j]) + " ";
+      result += to_string(data[i * cols + j]) + " ";
     }
     result += "\n";
   }
@@ -0,0 +1,66 @@
+#include "MatrixCache.hpp"
+
+#include <algorithm>
+
+MatrixCache::MatrixCache(size_t capacity) : capacity(capacity) {
+  if (capacity == 0) {
+    throw invalid_argument("MatrixCache: capacity should be at least 1");
+  }
+}
+
+shared_ptr<const Matrix> MatrixCache::get(Kind kind, int id,
+                                          const function<Matrix()>& build) {
+  Key key = make_pair(static_cast<int>(kind), id);
+  {
+    lock_guard<mutex> lock(mtx);
+    auto it = index.find(key);
+    if (it != index.end()) {
+      entries.splice(entries.begin(), entries, it->second);
+      return it->second->second;
+    }
+  }
+
+  // Build outside the lock so that misses on different keys run in parallel
+  shared_ptr<const Matrix> value = make_shared<const Matrix>(build());
+
+  lock_guard<mutex> lock(mtx);
+  auto it = index.find(key);
+  if (it != index.end()) {
+    // Another thread built the same entry in the meantime, keep theirs
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+  }
+  entries.emplace_front(key, value);
+  index[key] = entries.begin();
+  if (entries.size() > capacity) {
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+  return value;
+}
+
+bool MatrixCache::contains(Kind kind, int id) const {
+  lock_guard<mutex> lock(mtx);
+  return index.count(make_pair(static_cast<int>(kind), id)) != 0;
+}
+
+void MatrixCache::reserve(size_t capacity) {
+  lock_guard<mutex> lock(mtx);
+  this->capacity = max(this->capacity, capacity);
+}
+
+void MatrixCache::clear() {
+  lock_guard<mutex> lock(mtx);
+  entries.clear();
+  index.clear();
+}
+
+size_t MatrixCache::size() const {
+  lock_guard<mutex> lock(mtx);
+  return entries.size();
+}
+
+size_t MatrixCache::getCapacity() const {
+  lock_guard<mutex> lock(mtx);
+  return capacity;
+}
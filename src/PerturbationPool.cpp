@@ -0,0 +1,73 @@
+#include "PerturbationPool.hpp"
+
+#include <chrono>
+
+#include "MP12.hpp"
+
+PerturbationPool::PerturbationPool(unsigned int n, unsigned int extra,
+                                   double extraStddev, size_t capacity,
+                                   size_t threads)
+    : n(n),
+      k(Matrix::getK()),
+      extra(extra),
+      extraSampler(extraStddev, Matrix::getModulus()),
+      queue(capacity),
+      stopping(false),
+      context(CryptoContext::installed()) {
+  for (size_t i = 0; i < threads; i++) {
+    producers.emplace_back([this]() {
+      CryptoContext::Scope scope(context);
+      produce();
+    });
+  }
+}
+
+PerturbationPool::~PerturbationPool() {
+  stopping.store(true);
+  for (thread& producer : producers) {
+    producer.join();
+  }
+}
+
+bool PerturbationPool::tryTake(vector<BigInt>& item) {
+  return queue.tryPop(item);
+}
+
+void PerturbationPool::take(vector<BigInt>& item) {
+  if (!queue.tryPop(item)) {
+    generate(item);
+  }
+}
+
+size_t PerturbationPool::available() const { return queue.size(); }
+
+unsigned int PerturbationPool::getGadgetLength() const { return n * k; }
+
+unsigned int PerturbationPool::getExtraLength() const { return extra; }
+
+void PerturbationPool::generate(vector<BigInt>& item) {
+  item.resize(static_cast<size_t>(n) * k + extra);
+  for (unsigned int i = 0; i < n; i++) {
+    MP12::gadgetPerturbation(item.data() + static_cast<size_t>(i) * k);
+  }
+  for (unsigned int i = 0; i < extra; i++) {
+    item[static_cast<size_t>(n) * k + i] = extraSampler.GenerateInteger();
+  }
+}
+
+void PerturbationPool::produce() {
+  vector<BigInt> item;
+  bool pending = false;
+  while (!stopping.load(memory_order_relaxed)) {
+    if (!pending) {
+      generate(item);
+      pending = true;
+    }
+    if (queue.tryPush(std::move(item))) {
+      pending = false;
+    } else {
+      // Full, wait for consumers without holding any lock
+      this_thread::sleep_for(chrono::microseconds(200));
+    }
+  }
+}
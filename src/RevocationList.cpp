@@ -0,0 +1,191 @@
+#include "RevocationList.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Tree.hpp"
+
+// Level of heap index v, i.e. floor(log2(v + 1))
+static unsigned int levelOf(unsigned int v) {
+  return 31 - __builtin_clz(v + 1);
+}
+
+RevocationList::RevocationList() : RevocationList(0) {}
+
+RevocationList::RevocationList(unsigned int capacity)
+    : capacity(capacity),
+      since(capacity, INT_MAX),
+      current(INT_MIN),
+      active(0),
+      coverSize(0) {
+  size_t nodes = capacity == 0 ? 0 : 2 * static_cast<size_t>(capacity) - 1;
+  for (size_t first = 0; first < nodes; first = 2 * first + 1) {
+    size_t width = min(nodes, 2 * first + 1) - first;
+    onPath.emplace_back((width + 63) / 64);
+    covered.emplace_back((width + 63) / 64);
+  }
+  // Nothing is revoked, so the root alone covers every user
+  if (nodes != 0) {
+    assign(covered, 0, true);
+    coverSize = 1;
+  }
+}
+
+unsigned int RevocationList::getCapacity() const { return capacity; }
+
+bool RevocationList::test(const LevelBitmap& bits, unsigned int v) {
+  unsigned int d = levelOf(v);
+  unsigned int i = v - ((1u << d) - 1);
+  return (bits[d][i >> 6] >> (i & 63)) & 1;
+}
+
+void RevocationList::assign(LevelBitmap& bits, unsigned int v, bool value) {
+  unsigned int d = levelOf(v);
+  unsigned int i = v - ((1u << d) - 1);
+  uint64_t mask = uint64_t(1) << (i & 63);
+  bits[d][i >> 6] = value ? bits[d][i >> 6] | mask : bits[d][i >> 6] & ~mask;
+}
+
+void RevocationList::updateCover(unsigned int v) const {
+  // v is in the cover when it has no revoked leaf below it but its parent
+  // has, or when it is the root and nothing is revoked
+  bool in = !test(onPath, v) &&
+            (v == 0 || test(onPath, BinaryTree::parent(v)));
+  if (in != test(covered, v)) {
+    assign(covered, v, in);
+    coverSize += in ? 1 : -1;
+  }
+}
+
+void RevocationList::setLeaf(unsigned int user, bool revoked) const {
+  unsigned int v = capacity - 1 + user;
+  size_t nodes = 2 * static_cast<size_t>(capacity) - 1;
+  bool value = revoked;
+  // Walk up while the on-path bit of the node changes; each change can only
+  // move the node itself and its two children in or out of the cover
+  while (true) {
+    if (test(onPath, v) == value) {
+      break;
+    }
+    assign(onPath, v, value);
+    updateCover(v);
+    for (unsigned int c : {BinaryTree::left(v), BinaryTree::right(v)}) {
+      if (c < nodes) {
+        updateCover(c);
+      }
+    }
+    if (v == 0) {
+      break;
+    }
+    // the parent is on a revoked path if either of its children is
+    unsigned int sibling = v % 2 == 1 ? v + 1 : v - 1;
+    value = value || test(onPath, sibling);
+    v = BinaryTree::parent(v);
+  }
+  active += revoked ? 1 : -1;
+}
+
+void RevocationList::moveTo(int t) const {
+  if (t > current) {
+    for (auto it = schedule.upper_bound(current);
+         it != schedule.end() && it->first <= t; ++it) {
+      for (unsigned int user : it->second) {
+        setLeaf(user, true);
+      }
+    }
+  } else if (t < current) {
+    for (auto it = schedule.upper_bound(t);
+         it != schedule.end() && it->first <= current; ++it) {
+      for (unsigned int user : it->second) {
+        setLeaf(user, false);
+      }
+    }
+  }
+  current = t;
+}
+
+void RevocationList::unschedule(unsigned int user) {
+  auto it = schedule.find(since[user]);
+  if (it == schedule.end()) {
+    return;
+  }
+  vector<unsigned int>& users = it->second;
+  users.erase(find(users.begin(), users.end(), user));
+  if (users.empty()) {
+    schedule.erase(it);
+  }
+}
+
+void RevocationList::revoke(unsigned int user, int time) {
+  revoke(vector<unsigned int>{user}, time);
+}
+
+void RevocationList::revoke(const vector<unsigned int>& users, int time) {
+  lock_guard<mutex> lock(mtx);
+  for (unsigned int user : users) {
+    if (user >= capacity) {
+      throw invalid_argument("RevocationList: invalid user ID");
+    }
+  }
+  for (unsigned int user : users) {
+    if (time >= since[user]) {
+      continue;
+    }
+    bool wasActive = since[user] <= current;
+    unschedule(user);
+    since[user] = time;
+    schedule[time].push_back(user);
+    if (!wasActive && time <= current) {
+      setLeaf(user, true);
+    }
+  }
+}
+
+void RevocationList::expire(const vector<unsigned int>& users) {
+  lock_guard<mutex> lock(mtx);
+  for (unsigned int user : users) {
+    if (user >= capacity) {
+      throw invalid_argument("RevocationList: invalid user ID");
+    }
+    if (since[user] == INT_MAX) {
+      continue;
+    }
+    if (since[user] <= current) {
+      setLeaf(user, false);
+    }
+    unschedule(user);
+    since[user] = INT_MAX;
+  }
+}
+
+int RevocationList::revokedAt(unsigned int user) const {
+  lock_guard<mutex> lock(mtx);
+  if (user >= capacity) {
+    throw invalid_argument("RevocationList: invalid user ID");
+  }
+  return since[user];
+}
+
+size_t RevocationList::count(int t) const {
+  lock_guard<mutex> lock(mtx);
+  moveTo(t);
+  return active;
+}
+
+vector<unsigned int> RevocationList::cover(int t) const {
+  lock_guard<mutex> lock(mtx);
+  moveTo(t);
+  vector<unsigned int> nodes;
+  nodes.reserve(coverSize);
+  for (size_t d = 0; d < covered.size(); d++) {
+    unsigned int first = (1u << d) - 1;
+    for (size_t w = 0; w < covered[d].size(); w++) {
+      uint64_t word = covered[d][w];
+      while (word != 0) {
+        nodes.push_back(first + 64 * w + __builtin_ctzll(word));
+        word &= word - 1;
+      }
+    }
+  }
+  return nodes;
+}
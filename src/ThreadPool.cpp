@@ -0,0 +1,176 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Index of the current thread's queue in the pool that owns it, if any
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+ThreadPool::ThreadPool(size_t threads, bool background)
+    : pending(0), nextQueue(0), stopping(false) {
+  // One thread is always the caller, the pool only adds helpers
+  size_t helpers = threads > 1 ? threads - 1 : 0;
+  for (size_t i = 0; i < helpers; i++) {
+    queues.emplace_back(new WorkQueue());
+  }
+  for (size_t i = 0; i < helpers; i++) {
+    workers.emplace_back(
+        [this, i, background]() { workerLoop(i, background); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(sleepMtx);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (thread& worker : workers) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::instance() {
+  static ThreadPool pool;
+  return currentPool != nullptr ? *currentPool : pool;
+}
+
+size_t ThreadPool::size() const { return workers.size() + 1; }
+
+void ThreadPool::enqueue(function<void()> job) {
+  if (workers.empty()) {
+    job();
+    return;
+  }
+  // Tasks run under the crypto context of the thread that queued them
+  CryptoContext* context = CryptoContext::installed();
+  if (context != nullptr) {
+    job = [context, inner = std::move(job)]() {
+      CryptoContext::Scope scope(context);
+      inner();
+    };
+  }
+  // Jobs spawned by a worker stay on its own queue, others are spread out
+  size_t target = currentPool == this
+                      ? currentQueue
+                      : nextQueue.fetch_add(1) % queues.size();
+  {
+    lock_guard<mutex> lock(queues[target]->mtx);
+    queues[target]->jobs.push_back(std::move(job));
+  }
+  {
+    lock_guard<mutex> lock(sleepMtx);
+    pending++;
+  }
+  ready.notify_one();
+}
+
+bool ThreadPool::takeJob(size_t self, function<void()>& job) {
+  // Newest job from the own queue first, then the oldest job of another
+  // worker, which tends to be the largest piece of work left
+  {
+    WorkQueue& own = *queues[self];
+    lock_guard<mutex> lock(own.mtx);
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      pending--;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues.size(); i++) {
+    WorkQueue& victim = *queues[(self + i) % queues.size()];
+    lock_guard<mutex> lock(victim.mtx);
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::workerLoop(size_t self, bool background) {
+  currentPool = this;
+  currentQueue = self;
+#ifdef __linux__
+  if (background) {
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+  }
+#endif
+  while (true) {
+    function<void()> job;
+    if (takeJob(self, job)) {
+      job();
+      continue;
+    }
+    unique_lock<mutex> lock(sleepMtx);
+    ready.wait(lock, [this]() { return stopping || pending.load() > 0; });
+    if (stopping && pending.load() == 0) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end,
+                             const function<void(size_t)>& body,
+                             size_t grain) {
+  if (begin >= end) {
+    return;
+  }
+  grain = max<size_t>(grain, 1);
+  size_t chunks = (end - begin + grain - 1) / grain;
+
+  // Chunks are claimed from a shared counter by the caller and by helper
+  // jobs alike; a helper that starts after the loop is done finds nothing
+  // left and returns, so the state is shared rather than on the stack.
+  struct Loop {
+    atomic<size_t> next{0};
+    atomic<size_t> done{0};
+    mutex mtx;
+    condition_variable finished;
+    exception_ptr error;
+  };
+  auto loop = make_shared<Loop>();
+
+  auto run = [loop, begin, end, grain, chunks, &body]() {
+    size_t c;
+    while ((c = loop->next.fetch_add(1)) < chunks) {
+      size_t first = begin + c * grain;
+      size_t last = min(end, first + grain);
+      try {
+        for (size_t i = first; i < last; i++) {
+          body(i);
+        }
+      } catch (...) {
+        lock_guard<mutex> lock(loop->mtx);
+        if (!loop->error) {
+          loop->error = current_exception();
+        }
+      }
+      if (loop->done.fetch_add(1) + 1 == chunks) {
+        lock_guard<mutex> lock(loop->mtx);
+        loop->finished.notify_all();
+      }
+    }
+  };
+
+  size_t helpers = min(workers.size(), chunks - 1);
+  for (size_t i = 0; i < helpers; i++) {
+    enqueue(run);
+  }
+  run();
+
+  unique_lock<mutex> lock(loop->mtx);
+  loop->finished.wait(lock, [&]() { return loop->done.load() == chunks; });
+  if (loop->error) {
+    rethrow_exception(loop->error);
+  }
+}
@@ -0,0 +1,181 @@
+#include "Trapdoor.hpp"
+
+#include <algorithm>
+
+#include "MP12.hpp"
+#include "ParamSet.hpp"
+#include "PerturbationPool.hpp"
+#include "ThreadPool.hpp"
+
+// acc[j] += r * z[j] over one row of G^-1 samples. |r| < 2^15 and the
+// samples are small, so the sums stay exact in 64 bits.
+__attribute__((target_clones("avx2", "default"))) static void accumulateRow(
+    int64_t* acc, int32_t r, const int32_t* z, unsigned int n) {
+  for (unsigned int j = 0; j < n; ++j) {
+    acc[j] += static_cast<int64_t>(r) * z[j];
+  }
+}
+
+Trapdoor::Trapdoor() : rows(0), cols(0) {}
+
+Trapdoor::Trapdoor(const Matrix& R)
+    : rows(R.getRows()),
+      cols(R.getCols()),
+      R(static_cast<size_t>(R.getRows()) * R.getCols()) {
+  BigInt q = Matrix::getModulus();
+  // Centered entries reach q / 2, which has to fit int16
+  if (q >= 65536) {
+    throw invalid_argument("Trapdoor: modulus does not fit 16-bit entries");
+  }
+  for (unsigned int i = 0; i < rows; i++) {
+    const BigInt* row = R.rowData(i);
+    for (unsigned int j = 0; j < cols; j++) {
+      BigInt x = row[j] > q / 2 ? row[j] - q : row[j];
+      this->R[static_cast<size_t>(i) * cols + j] = static_cast<int16_t>(x);
+    }
+  }
+}
+
+unsigned int Trapdoor::getRows() const { return rows; }
+
+unsigned int Trapdoor::getCols() const { return cols; }
+
+unsigned int Trapdoor::getPreimageRows() const { return rows + cols; }
+
+Matrix Trapdoor::toMatrix() const {
+  Matrix result(rows, cols);
+  for (unsigned int i = 0; i < rows; i++) {
+    for (unsigned int j = 0; j < cols; j++) {
+      result.set(i, j, R[static_cast<size_t>(i) * cols + j]);
+    }
+  }
+  return result;
+}
+
+Matrix Trapdoor::preimage(const Matrix& U, PerturbationPool* pool) const {
+  Matrix out(rows + cols, U.getCols());
+  preimage(U, out, pool);
+  return out;
+}
+
+void Trapdoor::checkShapes(const Matrix& U, const Matrix& out) const {
+  if (U.getRows() * Matrix::getK() != cols) {
+    throw invalid_argument("Trapdoor: target does not match the trapdoor");
+  }
+  if (out.getRows() != rows + cols || out.getCols() != U.getCols()) {
+    throw invalid_argument("Trapdoor: output must be (m + nk) x cols(U)");
+  }
+}
+
+void Trapdoor::sampleColumn(const Matrix& U, unsigned int j, const BigInt* p,
+                            int32_t* z, unsigned int width) const {
+  unsigned int k = Matrix::getK();
+  BigInt q = Matrix::getModulus();
+  BigInt x[64];
+  for (unsigned int i = 0; i < U.getRows(); i++) {
+    if (p != nullptr) {
+      MP12::gInverse(U.get(i, j), p + static_cast<size_t>(i) * k, x);
+    } else {
+      MP12::gInverse(U.get(i, j), x);
+    }
+    for (unsigned int kk = 0; kk < k; kk++) {
+      BigInt v = x[kk] > q / 2 ? x[kk] - q : x[kk];
+      z[static_cast<size_t>(i * k + kk) * width + j] = static_cast<int32_t>(v);
+    }
+  }
+}
+
+void Trapdoor::preimage(const Matrix& U, Matrix& out,
+                        PerturbationPool* pool) const {
+  checkShapes(U, out);
+  unsigned int width = U.getCols();
+
+  // z = G^-1(U), kept as small signed integers (nk x width, row-major)
+  vector<int32_t> z(static_cast<size_t>(cols) * width);
+  ThreadPool::instance().parallelFor(
+      0, width,
+      [&](size_t j) {
+        vector<BigInt> item;
+        bool precomputed = pool != nullptr && pool->tryTake(item);
+        sampleColumn(U, j, precomputed ? item.data() : nullptr, z.data(),
+                     width);
+      },
+      16);
+  combine(z, width, out);
+}
+
+void Trapdoor::preimage(const Matrix& U, Matrix& out,
+                        const BigInt* const* perturbations) const {
+  checkShapes(U, out);
+  unsigned int width = U.getCols();
+
+  vector<int32_t> z(static_cast<size_t>(cols) * width);
+  ThreadPool::instance().parallelFor(
+      0, width,
+      [&](size_t j) {
+        sampleColumn(U, j, perturbations[j], z.data(), width);
+      },
+      16);
+  combine(z, width, out);
+}
+
+Matrix Trapdoor::preimage(const Matrix& u, const BigInt* p) const {
+  if (u.getCols() != 1) {
+    throw invalid_argument("Trapdoor: expected a single target column");
+  }
+  Matrix out(rows + cols, 1);
+  preimage(u, out, &p);
+  return out;
+}
+
+void Trapdoor::combine(const vector<int32_t>& z, unsigned int width,
+                       Matrix& out) const {
+  BigInt q = Matrix::getModulus();
+
+  // Top block R z, one band of rows of R per task. Rows of z are walked in
+  // tiles so a tile stays in cache while the whole band is updated with it.
+  const unsigned int band = 32;
+  const unsigned int tile = 128;
+  const unsigned int bands = (rows + band - 1) / band;
+  ThreadPool::instance().parallelFor(0, bands, [&](size_t b) {
+    unsigned int first = b * band;
+    unsigned int last = min(rows, first + band);
+    vector<int64_t> acc(static_cast<size_t>(last - first) * width);
+    for (unsigned int l0 = 0; l0 < cols; l0 += tile) {
+      unsigned int l1 = min(cols, l0 + tile);
+      for (unsigned int i = first; i < last; i++) {
+        int64_t* a = acc.data() + static_cast<size_t>(i - first) * width;
+        const int16_t* r = R.data() + static_cast<size_t>(i) * cols;
+        for (unsigned int l = l0; l < l1; l++) {
+          if (r[l] != 0) {
+            const int32_t* zl = z.data() + static_cast<size_t>(l) * width;
+            accumulateRow(a, r[l], zl, width);
+          }
+        }
+      }
+    }
+    withModulus(q, [&](auto modulus) {
+      for (unsigned int i = first; i < last; i++) {
+        const int64_t* a =
+            acc.data() + static_cast<size_t>(i - first) * width;
+        BigInt* o = out.rowData(i);
+        for (unsigned int j = 0; j < width; j++) {
+          BigInt v = a[j] % modulus;
+          o[j] = v < 0 ? v + modulus : v;
+        }
+      }
+    });
+  });
+
+  // Bottom block z, the identity part of [R; I]
+  withModulus(q, [&](auto modulus) {
+    for (unsigned int l = 0; l < cols; l++) {
+      BigInt* o = out.rowData(rows + l);
+      const int32_t* zl = z.data() + static_cast<size_t>(l) * width;
+      for (unsigned int j = 0; j < width; j++) {
+        BigInt v = zl[j] % modulus;
+        o[j] = v < 0 ? v + modulus : v;
+      }
+    }
+  });
+}
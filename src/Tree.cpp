@@ -1,137 +1,91 @@
 #include "Tree.hpp"
 
 // TreeNode constructor
-TreeNode::TreeNode()
-    : u1(), u2(), left(nullptr), right(nullptr), parent(nullptr) {}
+TreeNode::TreeNode() : index(0) {}
 
-// BinaryTree private helper function for findithLeaf
-TreeNode* BinaryTree::findLeafHelper(TreeNode* node, int& currentIndex,
-                                     int targetIndex) {
-  if (!node) return nullptr;  // Base case: node is null
+// BinaryTree default constructor
+BinaryTree::BinaryTree() : capacity(0) {}
 
-  // Check if the node is a leaf
-  if (!node->left && !node->right) {
-    if (currentIndex == targetIndex) {
-      return node;  // Found the i-th leaf
-    }
-    currentIndex++;  // Update leaf count
+// BinaryTree constructor with the number of leaves
+BinaryTree::BinaryTree(unsigned int capacity)
+    : capacity(capacity), nodes(capacity == 0 ? 0 : 2 * capacity - 1) {
+  for (size_t v = 0; v < nodes.size(); ++v) {
+    nodes[v].index = v;
   }
-
-  // Recursively search in the left subtree
-  TreeNode* leftResult = findLeafHelper(node->left, currentIndex, targetIndex);
-  if (leftResult) return leftResult;  // If found in the left subtree, return it
-
-  // Recursively search in the right subtree
-  return findLeafHelper(node->right, currentIndex, targetIndex);
 }
 
-// BinaryTree default constructor
-BinaryTree::BinaryTree() : root(nullptr) {}
+unsigned int BinaryTree::getCapacity() const { return capacity; }
 
-// BinaryTree constructor with leaves parameter
-BinaryTree::BinaryTree(int leaves) : root(initializeTree(leaves)) {}
+unsigned int BinaryTree::size() const { return nodes.size(); }
 
-// BinaryTree method to initialize the tree
-TreeNode* BinaryTree::initializeTree(int leaves) {
-  if (leaves == 1) {
-    return new TreeNode();
+TreeNode* BinaryTree::node(unsigned int v) {
+  if (v >= nodes.size()) {
+    throw out_of_range("BinaryTree: node index out of range");
   }
-  int h = ceil(log2(leaves + 1));
-  int maxLeaves = pow(2, h - 1);
-  int leftLeaves = max(maxLeaves / 2, leaves - maxLeaves / 2);
-  int rightLeaves = leaves - leftLeaves;
+  return &nodes[v];
+}
 
-  TreeNode* node = new TreeNode();
-  node->left = initializeTree(leftLeaves);
-  node->right = initializeTree(rightLeaves);
-  node->left->parent = node;
-  node->right->parent = node;
-  return node;
+unsigned int BinaryTree::indexOf(const TreeNode* node) const {
+  if (nodes.empty() || node < nodes.data() ||
+      node >= nodes.data() + nodes.size()) {
+    throw invalid_argument("BinaryTree: node does not belong to this tree");
+  }
+  return node - nodes.data();
 }
 
 // BinaryTree method to find the i-th leaf node
 TreeNode* BinaryTree::findithLeaf(int i) {
-  int currentIndex = 0;
-  // cout << "Finding the " << i << "-th leaf node..." << endl;
-  return findLeafHelper(root, currentIndex, i);
+  if (i < 0 || static_cast<unsigned int>(i) >= capacity) {
+    return nullptr;
+  }
+  return &nodes[leafIndex(i)];
 }
 
-// BinaryTree method to get the path from the root to a given node
-set<TreeNode*> BinaryTree::path(TreeNode* v) {
-  std::set<TreeNode*> pathNodes;
-
-  // Traverse from the target node back to the root using parent pointers
-  TreeNode* current = v;
-  while (current != nullptr) {
-    pathNodes.insert(current);
-    current = current->parent;
+vector<unsigned int> BinaryTree::pathIndices(unsigned int v) const {
+  vector<unsigned int> pathNodes;
+  pathNodes.push_back(v);
+  while (v != 0) {
+    v = parent(v);
+    pathNodes.push_back(v);
   }
+  reverse(pathNodes.begin(), pathNodes.end());
   return pathNodes;
 }
 
-// BinaryTree method to get the KUNodes
-set<TreeNode*> BinaryTree::KUNodes(const set<pair<TreeNode*, int>>& RL, int t) {
-  set<TreeNode*> U;
-  set<TreeNode*> L;
-  for (auto item : RL) {
-    if (item.second <= t) {
-      set<TreeNode*> pathNodes = path(item.first);
-
-      L.insert(pathNodes.begin(), pathNodes.end());
-    }
+// BinaryTree method to get the path from the root to a given node
+vector<TreeNode*> BinaryTree::path(TreeNode* v) {
+  vector<TreeNode*> pathNodes;
+  for (unsigned int i : pathIndices(indexOf(v))) {
+    pathNodes.push_back(&nodes[i]);
   }
+  return pathNodes;
+}
 
-  for (auto node : L) {
-    if (node->left && L.find(node->left) == L.end()) {
-      U.insert(node->left);
-    }
-    if (node->right && L.find(node->right) == L.end()) {
-      U.insert(node->right);
-    }
+// BinaryTree method to get the KUNodes
+vector<TreeNode*> BinaryTree::KUNodes(const RevocationList& RL, int t) {
+  if (RL.getCapacity() != capacity) {
+    throw invalid_argument("KUNodes: revocation list is for another tree");
   }
-
-  if (U.empty()) {
-    U.insert(root);
+  vector<TreeNode*> cover;
+  for (unsigned int v : RL.cover(t)) {
+    cover.push_back(&nodes[v]);
   }
-
-  // cout << "U size: " << U.size() << endl;
-
-  return U;
+  return cover;
 }
 
 // BinaryTree method to print the tree
 void BinaryTree::print() {
-  if (root == nullptr) {
+  if (nodes.empty()) {
     cout << "The tree is empty." << endl;
     return;
   }
 
-  queue<TreeNode*> q;
-  q.push(root);
-
-  while (!q.empty()) {
-    int levelSize = q.size();
-
-    for (int i = 0; i < levelSize; ++i) {
-      TreeNode* currentNode = q.front();
-      q.pop();
-
+  // Level d holds the nodes [2^d - 1, 2^(d + 1) - 1)
+  for (size_t first = 0; first < nodes.size(); first = 2 * first + 1) {
+    size_t last = min(nodes.size(), 2 * first + 1);
+    for (size_t v = first; v < last; ++v) {
       // Print current node's information
-      cout << "(";
-      if (!currentNode->u1.empty()) {
-        cout << "u1: " << currentNode->u1.size() << " ";
-      }
-      if (!currentNode->u2.empty()) {
-        cout << "u2: " << currentNode->u2.size();
-      }
-      cout << ") ";
-
-      if (currentNode->left != nullptr) {
-        q.push(currentNode->left);
-      }
-      if (currentNode->right != nullptr) {
-        q.push(currentNode->right);
-      }
+      cout << "(" << nodes[v].index << ") ";
     }
     cout << endl;
   }
@@ -15,10 +15,10 @@ void normalIBME() {
   int time0 = 0;
   int time1 = 1;
 
-  vector<Matrix> sender_key;
-  vector<vector<pair<TreeNode*, vector<Matrix>>>> receiver_key;
-  vector<pair<TreeNode*, vector<Matrix>>> key_update;
-  vector<pair<Matrix, Matrix>> decrytion_key;
+  vector<Trapdoor> sender_key;
+  vector<NodeKeys> receiver_key;
+  NodeKeys key_update;
+  DecryptionKey decrytion_key;
 
   bitset<MESSAGE_LEN> message("10100111");
 
@@ -45,11 +45,11 @@ void normalIBME() {
   // cout << "DKGen function executed successfully!" << endl;
 
   // test Enc
-  pair<vector<Matrix>, Matrix> ct =
+  Ciphertext ct =
       ibme.Enc(sender_key[sender_id], sender_id, receiver_id, message, time0);
   // for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-  //   cout << "ct.first[" << i << "]: " << endl;
-  //   ct.first[i].print();
+  //   cout << "ct.c1[" << i << "]: " << endl;
+  //   ct.getC1(i).print();
   // }
   // cout << "Enc function executed successfully!" << endl;
 
@@ -68,7 +68,7 @@ void benchmarkIBME() {
   }
   auto end = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double, std::milli> duration = end - start;
-  std::cout << "Whole system time: " << duration.count() / 10 << " ms"
+  std::cout << "Whole system time: " << duration.count() / 5 << " ms"
             << std::endl;
 
   cout << "------------------------------------------------------------------"
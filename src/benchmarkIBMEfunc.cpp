@@ -14,11 +14,11 @@ void benchmarkIBMEfunc() {
   std::chrono::duration<double, std::milli> sduration = send - sstart;
   std::cout << "Setup time: " << sduration.count() << " ms" << std::endl;
 
-  vector<Matrix> sender_key(USER_NUM);
-  vector<vector<pair<TreeNode*, vector<Matrix>>>> receiver_key(USER_NUM);
-  vector<pair<TreeNode*, vector<Matrix>>> key_update;
-  vector<pair<Matrix, Matrix>> decrytion_key;
-  pair<vector<Matrix>, Matrix> ct;
+  vector<Trapdoor> sender_key(USER_NUM);
+  vector<NodeKeys> receiver_key(USER_NUM);
+  NodeKeys key_update;
+  DecryptionKey decrytion_key;
+  Ciphertext ct;
   bitset<MESSAGE_LEN> message("01011111");
 
   int sender_id = 2;
@@ -46,10 +46,17 @@ void benchmarkOp() {
             << std::endl;
 
   cout << "test Zq multiply" << endl;
-  BigInt product;
+  // Operands are sampled at runtime, constant ones fold away at compile time
+  DiscreteUniformSampler dus(MODULUS);
+  vector<BigInt> lhs(10), rhs(10);
+  for (int i = 0; i < 10; ++i) {
+    lhs[i] = dus.GenerateInteger();
+    rhs[i] = dus.GenerateInteger();
+  }
+  volatile BigInt product;
   auto zstart = std::chrono::high_resolution_clock::now();
   for (int i = 0; i < 10; ++i) {
-    product = (MODULUS - 1) * (MODULUS - 1) % MODULUS;
+    product = lhs[i] * rhs[i] % MODULUS;
   }
   auto zend = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double, std::milli> zduration = zend - zstart;
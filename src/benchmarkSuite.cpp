@@ -0,0 +1,518 @@
+#include <Hash.hpp>
+#include <IB-ME.hpp>
+#include <MP12.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Micro-benchmarks of every primitive, from matrix products up to the IB-ME
+// algorithms. Each benchmark is warmed up, then timed over repeated batches
+// of calls; a batch runs long enough for the clock resolution not to matter.
+// The median and the 90th/99th percentiles of the time per call are
+// reported, together with a throughput; with fewer than 100 repetitions the
+// 99th percentile is the slowest batch. Every group draws all of its inputs
+// from its own context seeded with --seed before the first benchmark runs,
+// and every benchmark then restarts the stream of the context it samples
+// from with --seed and its name. Two builds therefore time the same inputs
+// and the same draws whatever the batch sizes and --filter, and their --json
+// outputs can be diffed directly; only draws made on pool threads depend on
+// the scheduling.
+//
+// usage: benchmarkSuite [--filter substring] [--reps n] [--warmup n]
+//                       [--max-time seconds] [--seed s] [--json path]
+
+typedef chrono::steady_clock Clock;
+
+// Keep the compiler from dropping a result that is never used
+template <typename T>
+static void keep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Options {
+  string filter;
+  unsigned int reps = 15;
+  unsigned int warmup = 1;
+  double maxTime = 5;  // seconds of timed batches per benchmark
+  uint64_t seed = 1;
+  string json;
+};
+
+struct Result {
+  string name;
+  string unit;  // throughput unit
+  double work;  // units of work per call
+  size_t batch;
+  vector<double> ns;  // time per call of every batch, sorted
+  double percentile(double p) const {
+    size_t rank = static_cast<size_t>(ceil(p / 100 * ns.size()));
+    return ns[max<size_t>(rank, 1) - 1];
+  }
+  double mean() const {
+    double sum = 0;
+    for (double t : ns) {
+      sum += t;
+    }
+    return sum / ns.size();
+  }
+  double stddev() const {
+    double mu = mean(), sum = 0;
+    for (double t : ns) {
+      sum += (t - mu) * (t - mu);
+    }
+    return ns.size() > 1 ? sqrt(sum / (ns.size() - 1)) : 0;
+  }
+  // Work per second at the median, GB/s for byte counts
+  double throughput() const {
+    double perSecond = work / (percentile(50) * 1e-9);
+    return unit == "GB/s" ? perSecond / 1e9 : perSecond;
+  }
+};
+
+class Suite {
+ public:
+  explicit Suite(const Options& options) : options(options) {}
+
+  // Whether the benchmarks of a group may be selected, so the other groups
+  // can skip building their inputs. Only a filter starting with a group
+  // name, e.g. "mp12/", rules groups out.
+  bool wants(const string& group) const {
+    static const vector<string> groups = {"matrix/", "sampler/", "hash/",
+                                          "mp12/", "ibme/"};
+    for (const string& other : groups) {
+      if (options.filter.compare(0, other.size(), other) == 0) {
+        return other == group;
+      }
+    }
+    return true;
+  }
+
+  uint64_t seed() const { return options.seed; }
+
+  // Time body, which does work units of unit per call and samples from
+  // context, the installed one by default
+  void run(const string& name, const string& unit, double work,
+           const function<void()>& body, CryptoContext* context = nullptr) {
+    if (!options.filter.empty() && name.find(options.filter) == string::npos) {
+      return;
+    }
+    Result result{name, unit, work, 1, {}};
+    CryptoContext* target = context ? context : CryptoContext::installed();
+    if (target != nullptr) {
+      target->restart(options.seed ^ nameHash(name));
+    }
+
+    // Warm up, the last call sizes the batches
+    double single = 0;
+    for (unsigned int i = 0; i < max(options.warmup, 1u); i++) {
+      Clock::time_point start = Clock::now();
+      body();
+      single = chrono::duration<double, nano>(Clock::now() - start).count();
+    }
+    const double batchNs = 2e6;
+    result.batch = max<size_t>(1, static_cast<size_t>(batchNs / single));
+
+    Clock::time_point deadline =
+        Clock::now() + chrono::duration_cast<Clock::duration>(
+                           chrono::duration<double>(options.maxTime));
+    for (unsigned int rep = 0; rep < options.reps; rep++) {
+      Clock::time_point start = Clock::now();
+      for (size_t i = 0; i < result.batch; i++) {
+        body();
+      }
+      double elapsed =
+          chrono::duration<double, nano>(Clock::now() - start).count();
+      result.ns.push_back(elapsed / result.batch);
+      if (rep + 1 >= 3 && Clock::now() > deadline) {
+        break;
+      }
+    }
+    sort(result.ns.begin(), result.ns.end());
+    print(result);
+    results.push_back(result);
+  }
+
+  void writeJson(ostream& out) const {
+    out << "{\n";
+    out << "  \"params\": {\"n\": " << ROWS << ", \"q\": " << MODULUS
+        << ", \"k\": " << K << ", \"m\": " << COLS << ", \"slots\": " << N
+        << ", \"users\": " << USER_NUM << "},\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"threads\": " << ThreadPool::instance().size() << ",\n";
+    out << "  \"compiler\": \"" << escape(__VERSION__) << "\",\n";
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      out << (i == 0 ? "\n" : ",\n") << fixed << setprecision(1);
+      out << "    {\"name\": \"" << escape(r.name) << "\", \"unit\": \""
+          << r.unit << "\", \"reps\": " << r.ns.size()
+          << ", \"batch\": " << r.batch
+          << ", \"median_ns\": " << r.percentile(50)
+          << ", \"p90_ns\": " << r.percentile(90)
+          << ", \"p99_ns\": " << r.percentile(99)
+          << ", \"min_ns\": " << r.ns.front()
+          << ", \"mean_ns\": " << r.mean()
+          << ", \"stddev_ns\": " << r.stddev() << ", \"throughput\": "
+          << setprecision(4) << r.throughput() << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+
+ private:
+  // FNV-1a, unlike std::hash the same with every standard library
+  static uint64_t nameHash(const string& name) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : name) {
+      h = (h ^ c) * 1099511628211ull;
+    }
+    return h;
+  }
+
+  static string escape(const string& s) {
+    string out;
+    for (char c : s) {
+      if (c == '"' || c == '\\') {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out;
+  }
+
+  static string duration(double ns) {
+    ostringstream out;
+    out << fixed << setprecision(2);
+    if (ns < 1e3) {
+      out << ns << " ns";
+    } else if (ns < 1e6) {
+      out << ns / 1e3 << " us";
+    } else if (ns < 1e9) {
+      out << ns / 1e6 << " ms";
+    } else {
+      out << ns / 1e9 << " s";
+    }
+    return out.str();
+  }
+
+  static void print(const Result& r) {
+    cout << left << setw(40) << r.name << right << " median "
+         << setw(10) << duration(r.percentile(50)) << "  p90 " << setw(10)
+         << duration(r.percentile(90)) << "  p99 " << setw(10)
+         << duration(r.percentile(99)) << "  " << setprecision(4)
+         << r.throughput() << " " << r.unit << "  (" << r.ns.size() << " x "
+         << r.batch << ")" << endl;
+  }
+
+  Options options;
+  vector<Result> results;
+};
+
+static string shape(unsigned int rows, unsigned int cols) {
+  return to_string(rows) + "x" + to_string(cols);
+}
+
+static string number(double value) {
+  ostringstream out;
+  out << value;
+  return out.str();
+}
+
+void matrixBenchmarks(Suite& suite) {
+  if (!suite.wants("matrix/")) {
+    return;
+  }
+  CryptoContext context(MODULUS, SIGMA, suite.seed());
+  CryptoContext::Scope active(context);
+  const double entry = sizeof(BigInt);
+  unsigned int n = ROWS, m = COLS;
+
+  // Inputs first, so the timed calls cannot shift them
+  Matrix A = Matrix::generateUniformRandomMatrix(n, 2 * m);
+  Matrix B = Matrix::generateUniformRandomMatrix(n, 2 * m);
+  Matrix M = Matrix::generateUniformRandomMatrix(n, m);
+  const vector<unsigned int> widths = {1u, 64u,
+                                       static_cast<unsigned int>(SLOT_CHUNK)};
+  vector<Matrix> xs;
+  for (unsigned int cols : widths) {
+    xs.push_back(Matrix::generateUniformRandomMatrix(m, cols));
+  }
+  Matrix square = Matrix::generateUniformRandomMatrix(n, n);
+  Matrix tail = Matrix::generateUniformRandomMatrix(n, 2 * m - n);
+  Matrix x = Matrix::generateUniformRandomMatrix(2 * m, 1);
+  vector<BigInt> a(4096), b(4096);
+  DiscreteUniformSampler uniform(MODULUS);
+  for (size_t i = 0; i < a.size(); i++) {
+    a[i] = uniform.GenerateInteger();
+    b[i] = uniform.GenerateInteger();
+  }
+
+  suite.run("matrix/add/" + shape(n, 2 * m), "GB/s", 3 * entry * n * 2 * m,
+            [&]() { keep(A + B); });
+  suite.run("matrix/transpose/" + shape(n, 2 * m), "GB/s",
+            2 * entry * n * 2 * m, [&]() { keep(A.transpose()); });
+
+  // Products of the shapes the scheme uses, throughput in multiply-adds
+  for (size_t i = 0; i < widths.size(); i++) {
+    const Matrix& right = xs[i];
+    suite.run("matrix/multiply/" + shape(n, m) + "*" + shape(m, widths[i]),
+              "MAC/s", static_cast<double>(n) * m * widths[i],
+              [&]() { keep(M * right); });
+  }
+  suite.run("matrix/multiply/" + shape(n, n) + "*" + shape(n, m), "MAC/s",
+            static_cast<double>(n) * n * m, [&]() { keep(square * M); });
+
+  suite.run("matrix/multiplyHNF/" + shape(n, 2 * m) + "*" + shape(2 * m, 1),
+            "MAC/s", static_cast<double>(n) * (2 * m - n),
+            [&]() { keep(Matrix::multiplyHNF(tail, x)); });
+
+  // Element-wise Zq arithmetic on runtime operands
+  suite.run("matrix/zq-multiply", "samples/s", a.size(), [&]() {
+    BigInt acc = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+      acc += a[i] * b[i] % MODULUS;
+    }
+    keep(acc);
+  });
+}
+
+void samplerBenchmarks(Suite& suite) {
+  if (!suite.wants("sampler/")) {
+    return;
+  }
+  CryptoContext context(MODULUS, SIGMA, suite.seed());
+  CryptoContext::Scope active(context);
+  const unsigned int batch = 4096;
+
+  DiscreteGaussianSampler gaussian(SIGMA, MODULUS);
+  suite.run("sampler/gaussian/sigma=" + number(SIGMA), "samples/s", batch,
+            [&]() {
+              for (unsigned int i = 0; i < batch; i++) {
+                keep(gaussian.GenerateInteger());
+              }
+            });
+  DiscreteGaussianSampler noise(NOISE_SIGMA, MODULUS);
+  suite.run("sampler/gaussian/sigma=" + number(NOISE_SIGMA), "samples/s",
+            batch, [&]() {
+              for (unsigned int i = 0; i < batch; i++) {
+                keep(noise.GenerateInteger());
+              }
+            });
+  DiscreteUniformSampler uniform(MODULUS);
+  suite.run("sampler/uniform", "samples/s", batch, [&]() {
+    for (unsigned int i = 0; i < batch; i++) {
+      keep(uniform.GenerateInteger());
+    }
+  });
+  suite.run("sampler/gaussian-matrix/" + shape(ROWS, COLS), "samples/s",
+            static_cast<double>(ROWS) * COLS, [&]() {
+              keep(Matrix::generateDiscreteGaussianMatrix(ROWS, COLS, SIGMA));
+            });
+}
+
+void hashBenchmarks(Suite& suite) {
+  if (!suite.wants("hash/")) {
+    return;
+  }
+  CryptoContext context(MODULUS, SIGMA, suite.seed());
+  CryptoContext::Scope active(context);
+
+  for (size_t length : {64, 1024, 65536}) {
+    string input(length, 'a');
+    suite.run("hash/sha256/" + to_string(length) + "B", "GB/s", length,
+              [&]() { keep(SHA256::hash(input)); });
+  }
+  for (HashBackend backend :
+       {HashBackend::SHA256_CTR, HashBackend::SHAKE128_XOF}) {
+    string tag = backend == HashBackend::SHA256_CTR ? "sha256-ctr" : "shake128";
+    Hash H(ROWS, COLS, backend);
+    int counter = 0;
+    suite.run("hash/Hash::hash/" + tag + "/" + shape(ROWS, COLS), "samples/s",
+              static_cast<double>(ROWS) * COLS,
+              [&]() { keep(H.hash(to_string(counter++))); });
+  }
+}
+
+void mp12Benchmarks(Suite& suite) {
+  if (!suite.wants("mp12/")) {
+    return;
+  }
+  CryptoContext context(MODULUS, SIGMA, suite.seed());
+  CryptoContext::Scope active(context);
+  unsigned int n = ROWS, k = Matrix::getK(), m = n * k;
+  const unsigned int batch = 1024;
+  DiscreteUniformSampler uniform(MODULUS);
+  vector<BigInt> targets(batch);
+  for (BigInt& u : targets) {
+    u = uniform.GenerateInteger();
+  }
+  pair<Matrix, Matrix> trap = MP12::trapGenHNF(n);
+  Trapdoor trapdoor(trap.second);
+  Matrix U = Matrix::generateUniformRandomMatrix(n, 64);
+  Matrix preimages(trap.second.getRows() + m, U.getCols());
+  Matrix A1 = Matrix::generateUniformRandomMatrix(n, m);
+  Matrix M1 = Matrix::generateUniformRandomMatrix(n, 2 * m);
+  Matrix u = Matrix::generateUniformRandomMatrix(n, 1);
+  Matrix chunk = Matrix::generateUniformRandomMatrix(n, SLOT_CHUNK);
+
+  // G^-1 of single coordinates, DIRECT samples the gadget lattice and
+  // ORACLE is the table lookup O
+  for (MP12::GInverseMethod method : {MP12::DIRECT, MP12::ORACLE}) {
+    MP12::setGInverseMethod(method);
+    BigInt x[64];
+    suite.run(method == MP12::DIRECT ? "mp12/gInverse/direct"
+                                     : "mp12/gInverse/oracle",
+              "samples/s", batch, [&]() {
+                for (BigInt u : targets) {
+                  MP12::gInverse(u, x);
+                  keep(x);
+                }
+              });
+  }
+  MP12::setGInverseMethod(MP12::DIRECT);
+
+  suite.run("mp12/trapGen/n=" + to_string(n), "ops/s", 1,
+            [&]() { keep(MP12::trapGen(n)); });
+  suite.run("mp12/trapGenHNF/n=" + to_string(n), "ops/s", 1,
+            [&]() { keep(MP12::trapGenHNF(n)); });
+
+  suite.run("mp12/fAInverseBatch/" + shape(n, 64), "samples/s", U.getCols(),
+            [&]() {
+              MP12::fAInverseBatch(trap.second, U, preimages);
+              keep(preimages);
+            });
+
+  suite.run("mp12/delTrap/n=" + to_string(n), "ops/s", 1,
+            [&]() { keep(MP12::delTrap(trap.first, trapdoor, A1)); });
+
+  suite.run("mp12/SampleLeft/n=" + to_string(n), "samples/s", 1, [&]() {
+    keep(MP12::SampleLeft(trap.first, M1, trapdoor, u));
+  });
+  suite.run("mp12/SampleLeftBatch/" + shape(n, SLOT_CHUNK), "samples/s",
+            SLOT_CHUNK, [&]() {
+              keep(MP12::SampleLeftBatch(trap.first, M1, trapdoor, chunk));
+            });
+}
+
+void ibmeBenchmarks(Suite& suite) {
+  if (!suite.wants("ibme/")) {
+    return;
+  }
+  auto context = [&]() {
+    return make_shared<CryptoContext>(MODULUS, SIGMA, suite.seed());
+  };
+
+  // The instance and its keys are built before any benchmark runs; every
+  // benchmark restarts the instance's stream, which its algorithms sample
+  // from. Setup builds a fresh context per call.
+  IBME ibme(USER_NUM, context());
+  int sender_id = 2 % USER_NUM, receiver_id = 3 % USER_NUM;
+  bitset<MESSAGE_LEN> message;
+  for (unsigned int i = 0; i < MESSAGE_LEN; i += 3) {
+    message.set(i);
+  }
+
+  Trapdoor sender_key = ibme.SKGen(sender_id);
+  NodeKeys receiver_key = ibme.RKGen(receiver_id);
+  NodeKeys key_update = ibme.KUpdGen(ibme.RL, 0);
+  DecryptionKey decryption_key =
+      ibme.DKGen(receiver_key, receiver_id, key_update, 0);
+  ibme.checkDecryptionKey(decryption_key, receiver_id, 0);
+  Ciphertext ct = ibme.Enc(sender_key, sender_id, receiver_id, message, 0);
+  if (ibme.Dec(decryption_key, receiver_id, sender_id, ct) !=
+      message.to_string()) {
+    throw runtime_error("benchmarkSuite: decryption does not match");
+  }
+  CryptoContext* own = &ibme.getContext();
+
+  suite.run("ibme/Setup", "ops/s", 1,
+            [&]() { keep(IBME(USER_NUM, context())); });
+  suite.run(
+      "ibme/SKGen", "ops/s", 1, [&]() { keep(ibme.SKGen(sender_id)); }, own);
+  suite.run(
+      "ibme/RKGen", "ops/s", 1, [&]() { keep(ibme.RKGen(receiver_id)); },
+      own);
+  suite.run(
+      "ibme/KUpdGen", "ops/s", 1, [&]() { keep(ibme.KUpdGen(ibme.RL, 0)); },
+      own);
+  suite.run(
+      "ibme/DKGen", "ops/s", 1,
+      [&]() { keep(ibme.DKGen(receiver_key, receiver_id, key_update, 0)); },
+      own);
+  suite.run(
+      "ibme/Enc", "ops/s", 1,
+      [&]() { keep(ibme.Enc(sender_key, sender_id, receiver_id, message, 0)); },
+      own);
+  suite.run(
+      "ibme/Dec", "ops/s", 1,
+      [&]() { keep(ibme.Dec(decryption_key, receiver_id, sender_id, ct)); },
+      own);
+
+  // Every call revokes a user at an earlier epoch than before, so none of
+  // them is a no-op
+  int epoch = 1 << 30;
+  int user = 0;
+  suite.run(
+      "ibme/KRev", "ops/s", 1,
+      [&]() {
+        ibme.KRev(user, epoch--);
+        user = (user + 1) % USER_NUM;
+      },
+      own);
+}
+
+static void usage() {
+  cerr << "usage: benchmarkSuite [--filter substring] [--reps n] "
+          "[--warmup n] [--max-time seconds] [--seed s] [--json path]"
+       << endl;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--help" || i + 1 >= argc) {
+      usage();
+      return arg == "--help" ? 0 : 1;
+    }
+    string value = argv[++i];
+    if (arg == "--filter") {
+      options.filter = value;
+    } else if (arg == "--reps") {
+      options.reps = max(stoul(value), 1ul);
+    } else if (arg == "--warmup") {
+      options.warmup = stoul(value);
+    } else if (arg == "--max-time") {
+      options.maxTime = stod(value);
+    } else if (arg == "--seed") {
+      options.seed = stoull(value);
+    } else if (arg == "--json") {
+      options.json = value;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  Suite suite(options);
+  matrixBenchmarks(suite);
+  samplerBenchmarks(suite);
+  hashBenchmarks(suite);
+  mp12Benchmarks(suite);
+  ibmeBenchmarks(suite);
+
+  if (!options.json.empty()) {
+    ofstream out(options.json);
+    if (!out) {
+      cerr << "benchmarkSuite: cannot write " << options.json << endl;
+      return 1;
+    }
+    suite.writeJson(out);
+  }
+  return 0;
+}
@@ -17,10 +17,10 @@ void testIBME(enum TEST_SITUATION situation) {
   int time0 = 0;
   int time1 = 1;
 
-  vector<Matrix> sender_key;
-  vector<vector<pair<TreeNode*, vector<Matrix>>>> receiver_key;
-  vector<pair<TreeNode*, vector<Matrix>>> key_update;
-  vector<pair<Matrix, Matrix>> decrytion_key;
+  vector<Trapdoor> sender_key;
+  vector<NodeKeys> receiver_key;
+  NodeKeys key_update;
+  DecryptionKey decrytion_key;
 
   bitset<MESSAGE_LEN> message("10100111");
 
@@ -45,14 +45,15 @@ void testIBME(enum TEST_SITUATION situation) {
     // test DKGen
     decrytion_key =
         ibme.DKGen(receiver_key[receiver_id], receiver_id, key_update, time0);
+    ibme.checkDecryptionKey(decrytion_key, receiver_id, time0);
     cout << "DKGen function executed successfully!" << endl;
 
     // test Enc
-    pair<vector<Matrix>, Matrix> ct =
+    Ciphertext ct =
         ibme.Enc(sender_key[sender_id], sender_id, receiver_id, message, time0);
     for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-      cout << "ct.first[" << i << "]: " << endl;
-      ct.first[i].print();
+      cout << "ct.c1[" << i << "]: " << endl;
+      ct.getC1(i).print();
     }
     cout << "Enc function executed successfully!" << endl;
 
@@ -74,15 +75,16 @@ void testIBME(enum TEST_SITUATION situation) {
     // note that we here create a decryption key for receiver_id + 1
     decrytion_key = ibme.DKGen(receiver_key[receiver_id + 1], receiver_id + 1,
                                key_update, time0);
+    ibme.checkDecryptionKey(decrytion_key, receiver_id + 1, time0);
     cout << "DKGen function executed successfully!" << endl;
 
     // test Enc
     // note that the intended receiver of this ciphertext is receiver_id
-    pair<vector<Matrix>, Matrix> ct =
+    Ciphertext ct =
         ibme.Enc(sender_key[sender_id], sender_id, receiver_id, message, time0);
     for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-      cout << "ct.first[" << i << "]: " << endl;
-      ct.first[i].print();
+      cout << "ct.c1[" << i << "]: " << endl;
+      ct.getC1(i).print();
     }
     cout << "Enc function executed successfully!" << endl;
 
@@ -114,11 +116,11 @@ void testIBME(enum TEST_SITUATION situation) {
     cout << "DKGen function executed successfully!" << endl;
 
     // test Enc
-    pair<vector<Matrix>, Matrix> ct =
+    Ciphertext ct =
         ibme.Enc(sender_key[sender_id], sender_id, receiver_id, message, time1);
     for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-      cout << "ct.first[" << i << "]: " << endl;
-      ct.first[i].print();
+      cout << "ct.c1[" << i << "]: " << endl;
+      ct.getC1(i).print();
     }
 
     cout << "Enc function executed successfully!" << endl;
@@ -184,11 +186,11 @@ void benchmarkOp() {
 
 void benchmarkIBMEfunc() {
   IBME ibme;
-  vector<Matrix> sender_key(USER_NUM);
-  vector<vector<pair<TreeNode*, vector<Matrix>>>> receiver_key(USER_NUM);
-  vector<pair<TreeNode*, vector<Matrix>>> key_update;
-  vector<pair<Matrix, Matrix>> decrytion_key;
-  pair<vector<Matrix>, Matrix> ct;
+  vector<Trapdoor> sender_key(USER_NUM);
+  vector<NodeKeys> receiver_key(USER_NUM);
+  NodeKeys key_update;
+  DecryptionKey decrytion_key;
+  Ciphertext ct;
   bitset<MESSAGE_LEN> message("01011111");
 
   int sender_id = 2;
@@ -287,10 +289,10 @@ void normalIBME() {
   int time0 = 0;
   int time1 = 1;
 
-  vector<Matrix> sender_key;
-  vector<vector<pair<TreeNode*, vector<Matrix>>>> receiver_key;
-  vector<pair<TreeNode*, vector<Matrix>>> key_update;
-  vector<pair<Matrix, Matrix>> decrytion_key;
+  vector<Trapdoor> sender_key;
+  vector<NodeKeys> receiver_key;
+  NodeKeys key_update;
+  DecryptionKey decrytion_key;
 
   bitset<MESSAGE_LEN> message("10100111");
 
@@ -317,11 +319,11 @@ void normalIBME() {
   // cout << "DKGen function executed successfully!" << endl;
 
   // test Enc
-  pair<vector<Matrix>, Matrix> ct =
+  Ciphertext ct =
       ibme.Enc(sender_key[sender_id], sender_id, receiver_id, message, time0);
   // for (unsigned int i = 0; i < MESSAGE_LEN; i++) {
-  //   cout << "ct.first[" << i << "]: " << endl;
-  //   ct.first[i].print();
+  //   cout << "ct.c1[" << i << "]: " << endl;
+  //   ct.getC1(i).print();
   // }
   // cout << "Enc function executed successfully!" << endl;
 
@@ -0,0 +1,68 @@
+#include "BitVector.hpp"
+#include "Check.hpp"
+
+// Coefficients of every width come back unchanged, including fields that
+// straddle a word boundary, and packing leaves the neighbouring bits alone
+TEST(bitVector, coefficientsRoundTrip) {
+  for (unsigned int k : {1u, 5u, 12u, 17u, 63u}) {
+    size_t count = 29;
+    size_t offset = 3;
+    BitVector v(offset + count * k + 7);
+    for (size_t i = 0; i < v.size(); i++) {
+      v.set(i, 1);
+    }
+    vector<BigInt> values(count);
+    for (size_t i = 0; i < count; i++) {
+      values[i] = static_cast<BigInt>((i * 2654435761u + 12345) &
+                                      ((uint64_t(1) << k) - 1));
+    }
+    v.packCoefficients(offset, values.data(), count, k);
+    vector<BigInt> back(count);
+    v.unpackCoefficients(offset, back.data(), count, k);
+    CHECK(back == values);
+    for (size_t i = 0; i < offset; i++) {
+      CHECK(v.get(i) == 1);
+    }
+    for (size_t i = offset + count * k; i < v.size(); i++) {
+      CHECK(v.get(i) == 1);
+    }
+  }
+}
+
+// A field holds its value most significant bit first
+TEST(bitVector, fieldsAreMostSignificantBitFirst) {
+  BitVector v(16);
+  BigInt values[2] = {6, 1};  // 0110 and 0001
+  v.packCoefficients(4, values, 2, 4);
+  CHECK(v.toString(0, 16) == "0000011000010000");
+  CHECK_THROWS(v.packCoefficients(12, values, 2, 4));
+  CHECK_THROWS(v.packCoefficients(0, values, 1, 64));
+}
+
+TEST(bitVector, getAndSet) {
+  BitVector v(130);
+  v.set(0, 1);
+  v.set(64, 1);
+  v.set(129, 1);
+  v.set(64, 0);
+  CHECK(v.get(0) == 1);
+  CHECK(v.get(64) == 0);
+  CHECK(v.get(129) == 1);
+  CHECK(v.toString(127, 3) == "001");
+  CHECK_THROWS(v.toString(128, 3));
+}
+
+// A slot decodes to 1 exactly when it is within q / 4 of q / 2
+TEST(bitVector, decodeSlotsThresholds) {
+  const BigInt q = 3329;
+  vector<BigInt> w = {0,       q / 4,       q / 4 + 1, q / 2,
+                      q / 2 + q / 4 - 1, q / 2 + q / 4, q - 1};
+  vector<unsigned int> expected = {0, 0, 1, 1, 1, 0, 0};
+  // Start next to a word boundary so the slots span two words
+  BitVector v(70);
+  v.decodeSlots(60, w.data(), w.size(), q);
+  for (size_t i = 0; i < w.size(); i++) {
+    CHECK(v.get(60 + i) == expected[i]);
+  }
+  CHECK_THROWS(v.decodeSlots(64, w.data(), w.size(), q));
+}
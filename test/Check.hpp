@@ -0,0 +1,55 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DataType.hpp"
+
+// Minimal harness for the unit tests. Every test file registers its cases
+// with TEST(group, name), unitTests runs the cases of the groups given on the
+// command line, or all of them. A failed CHECK throws, which fails the case.
+struct TestCase {
+  const char* group;
+  const char* name;
+  void (*body)();
+};
+
+vector<TestCase>& testCases();
+
+struct TestRegistration {
+  TestRegistration(const char* group, const char* name, void (*body)()) {
+    testCases().push_back({group, name, body});
+  }
+};
+
+#define TEST(group, name)                                              \
+  static void group##_##name();                                        \
+  static TestRegistration group##_##name##_registration(#group, #name, \
+                                                        group##_##name); \
+  static void group##_##name()
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      throw runtime_error(string(__FILE__) + ":" + to_string(__LINE__) + \
+                          ": CHECK failed: " #condition);                  \
+    }                                                                      \
+  } while (0)
+
+#define CHECK_THROWS(expression)                                         \
+  do {                                                                   \
+    bool thrown = false;                                                 \
+    try {                                                                \
+      expression;                                                        \
+    } catch (const exception&) {                                         \
+      thrown = true;                                                     \
+    }                                                                    \
+    if (!thrown) {                                                       \
+      throw runtime_error(string(__FILE__) + ":" + to_string(__LINE__) + \
+                          ": expected an exception from " #expression);  \
+    }                                                                    \
+  } while (0)
+
+#endif  // CHECK_HPP
@@ -0,0 +1,120 @@
+#include "Check.hpp"
+#include "CryptoContext.hpp"
+#include "Matrix.hpp"
+#include "ThreadPool.hpp"
+
+// Scopes nest and restore the previous context, and contexts with different
+// moduli never see each other's parameters or the process default
+TEST(cryptoContext, scopesNestAndRestore) {
+  BigInt outside = Matrix::getModulus();
+  CryptoContext small(3329, 8, 1);
+  CryptoContext large(7681, 8, 1);
+  {
+    CryptoContext::Scope a(small);
+    CHECK(&CryptoContext::current() == &small);
+    CHECK(Matrix::getModulus() == 3329);
+    {
+      CryptoContext::Scope b(large);
+      CHECK(Matrix::getModulus() == 7681);
+      CHECK(Matrix::getK() == 13);
+      Matrix::setModulus(12289);
+      CHECK(large.getModulus() == 12289);
+    }
+    CHECK(CryptoContext::installed() == &small);
+    CHECK(Matrix::getModulus() == 3329);
+    CHECK(Matrix::getK() == 12);
+  }
+  CHECK(CryptoContext::installed() == nullptr);
+  CHECK(Matrix::getModulus() == outside);
+}
+
+// Contexts with the same seed draw the same values on their creating thread,
+// even when the thread keeps switching between them
+TEST(cryptoContext, sameSeedSameDraws) {
+  CryptoContext a(3329, 8, 5);
+  CryptoContext b(3329, 8, 5);
+  CryptoContext other(3329, 8, 6);
+  vector<uint32_t> first, second;
+  for (int i = 0; i < 8; i++) {
+    first.push_back(a.rng()());
+    other.rng()();
+  }
+  for (int i = 0; i < 8; i++) {
+    second.push_back(b.rng()());
+  }
+  CHECK(first == second);
+  uint32_t draw = a.rng()();
+  CHECK(draw == b.rng()());
+  CHECK(draw != other.rng()());
+
+  Matrix x, y;
+  {
+    CryptoContext::Scope active(a);
+    x = Matrix::generateUniformRandomMatrix(4, 4);
+  }
+  {
+    CryptoContext::Scope active(b);
+    y = Matrix::generateUniformRandomMatrix(4, 4);
+  }
+  CHECK(x == y);
+}
+
+// Pool tasks run under the context of the thread that queued them and draw
+// from a stream of their own
+TEST(cryptoContext, poolTasksInheritTheContext) {
+  ThreadPool pool(2);
+  CryptoContext context(7681, 8, 3);
+  CryptoContext twin(7681, 8, 3);
+  uint32_t creatorDraw = twin.rng()();
+  {
+    CryptoContext::Scope active(context);
+    auto task = pool.submit([]() {
+      return make_pair(&CryptoContext::current(), Matrix::getModulus());
+    });
+    pair<CryptoContext*, BigInt> seen = task.get();
+    CHECK(seen.first == &context);
+    CHECK(seen.second == 7681);
+    CHECK(pool.submit([&]() { return context.rng()(); }).get() != creatorDraw);
+  }
+  CHECK(pool.submit([]() { return CryptoContext::installed(); }).get() ==
+        nullptr);
+}
+
+// A pool thread alternating between contexts continues each stream where it
+// left off rather than seeding a new one
+TEST(cryptoContext, switchingBackResumesTheStream) {
+  ThreadPool pool(2);
+  CryptoContext a(3329, 8, 21);
+  CryptoContext b(3329, 8, 22);
+  bool resumed = pool.submit([&]() {
+    bool same = true;
+    for (int i = 0; i < 3; i++) {
+      mt19937 expected = a.rng();
+      expected();
+      a.rng()();
+      b.rng()();
+      same = same && a.rng()() == expected();
+    }
+    return same;
+  }).get();
+  CHECK(resumed);
+}
+
+// A restarted context draws what a fresh one with that seed draws, and only
+// its creator may restart it
+TEST(cryptoContext, restartMatchesAFreshContext) {
+  CryptoContext a(3329, 8, 31);
+  CryptoContext fresh(3329, 8, 32);
+  for (int i = 0; i < 5; i++) {
+    a.rng()();
+  }
+  a.restart(32);
+  bool same = true;
+  for (int i = 0; i < 8; i++) {
+    same = same && a.rng()() == fresh.rng()();
+  }
+  CHECK(same);
+
+  ThreadPool pool(2);
+  CHECK_THROWS(pool.submit([&]() { a.restart(33); }).get());
+}
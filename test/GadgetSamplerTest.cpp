@@ -0,0 +1,59 @@
+#include <cmath>
+
+#include "Check.hpp"
+#include "GadgetSampler.hpp"
+
+static BigInt residue(const BigInt* x, unsigned int k, BigInt q) {
+  BigInt u = 0;
+  for (unsigned int i = 0; i < k; i++) {
+    u += x[i] * (BigInt(1) << i);
+  }
+  return (u % q + q) % q;
+}
+
+TEST(gadgetSampler, hitsTheCoset) {
+  mt19937 rng(5);
+  for (BigInt q : {3329, 4096, 7681}) {
+    GadgetSampler gadget(q, 408);
+    unsigned int k = gadget.getK();
+    CHECK(k == static_cast<unsigned int>(ceil(log2(q))));
+    BigInt x[64], p[64];
+    for (BigInt u = 0; u < q; u += 37) {
+      gadget.sample(u, x, rng);
+      CHECK(residue(x, k, q) == u);
+      gadget.perturb(p, rng);
+      gadget.sampleWithPerturbation(u - q, p, x, rng);
+      CHECK(residue(x, k, q) == u);
+    }
+  }
+}
+
+// Every coordinate is centered with roughly the requested width
+TEST(gadgetSampler, coordinateStatistics) {
+  const BigInt q = 3329;
+  const double stddev = 408;
+  const unsigned int samples = 8000;
+  GadgetSampler gadget(q, stddev);
+  unsigned int k = gadget.getK();
+  mt19937 rng(11);
+  vector<double> sum(k, 0), squares(k, 0);
+  BigInt x[64];
+  for (unsigned int s = 0; s < samples; s++) {
+    gadget.sample(rng() % q, x, rng);
+    for (unsigned int i = 0; i < k; i++) {
+      sum[i] += x[i];
+      squares[i] += static_cast<double>(x[i]) * x[i];
+    }
+  }
+  for (unsigned int i = 0; i < k; i++) {
+    double mean = sum[i] / samples;
+    double width = sqrt(squares[i] / samples - mean * mean);
+    // The mean of 8000 draws is within 5 standard errors of 0
+    CHECK(fabs(mean) < 5 * stddev / sqrt(samples));
+    CHECK(width > 0.9 * stddev && width < 1.1 * stddev);
+  }
+}
+
+TEST(gadgetSampler, rejectsBadModulus) {
+  CHECK_THROWS(GadgetSampler(1, 408));
+}
@@ -0,0 +1,202 @@
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include "Check.hpp"
+#include "Hash.hpp"
+
+static string hex(const uint8_t* data, size_t length) {
+  ostringstream out;
+  for (size_t i = 0; i < length; i++) {
+    out << hex << setw(2) << setfill('0') << static_cast<int>(data[i]);
+  }
+  return out.str();
+}
+
+static string sha256(const string& input) {
+  array<uint8_t, 32> digest = SHA256::hash(input);
+  return hex(digest.data(), digest.size());
+}
+
+// FIPS 180-2 examples
+TEST(hash, sha256KnownAnswers) {
+  CHECK(sha256("") ==
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+  CHECK(sha256("abc") ==
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+  CHECK(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+  CHECK(sha256(string(1000000, 'a')) ==
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+// Splitting the input across update() calls must not change the digest
+TEST(hash, sha256Incremental) {
+  string input(1000, 'x');
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = static_cast<char>(i * 7);
+  }
+  for (size_t split : {0, 1, 63, 64, 65, 500, 1000}) {
+    SHA256 sha;
+    sha.update(reinterpret_cast<const uint8_t*>(input.data()), split);
+    sha.update(reinterpret_cast<const uint8_t*>(input.data()) + split,
+               input.size() - split);
+    sha.finalize();
+    array<uint8_t, 32> digest = sha.digest();
+    CHECK(hex(digest.data(), digest.size()) == sha256(input));
+  }
+}
+
+// Every lane of the multi-buffer path matches the scalar hash of
+// input || LE32(first + j)
+TEST(hash, sha256CounterLanes) {
+  const uint32_t first = 0xfffffffa;
+  for (size_t length : {0, 5, 55, 60, 64, 119, 200}) {
+    string input(length, 'q');
+    const size_t count = 13;
+    vector<uint8_t> out(count * SHA256::HashSize);
+    SHA256::hashCounter(reinterpret_cast<const uint8_t*>(input.data()),
+                        length, first, count, out.data());
+    for (size_t j = 0; j < count; j++) {
+      uint32_t counter = first + static_cast<uint32_t>(j);
+      string message = input;
+      for (int b = 0; b < 4; b++) {
+        message += static_cast<char>((counter >> (8 * b)) & 0xff);
+      }
+      CHECK(hex(out.data() + j * SHA256::HashSize, SHA256::HashSize) ==
+            sha256(message));
+    }
+  }
+}
+
+// Every compression core the CPU has agrees with the scalar one, on single
+// hashes and on counter lanes. Counts of 13 and 17 leave a partial batch of
+// eight lanes, and the tails take one or two blocks.
+TEST(hash, sha256CoresAgree) {
+  SHA256::Core detected = SHA256::activeCore();
+  const uint32_t first = 0xfffffff5;
+  const size_t count = 17;
+  const size_t lengths[] = {0, 51, 55, 56, 59, 60, 63, 64, 119, 200};
+
+  CHECK(SHA256::forceCore(SHA256::SCALAR));
+  map<size_t, vector<string>> expected;
+  for (size_t length : lengths) {
+    string input(length, 'q');
+    for (size_t i = 0; i < length; i++) {
+      input[i] = static_cast<char>(i * 31 + 1);
+    }
+    for (size_t j = 0; j < count; j++) {
+      uint32_t counter = first + static_cast<uint32_t>(j);
+      string message = input;
+      for (int b = 0; b < 4; b++) {
+        message += static_cast<char>((counter >> (8 * b)) & 0xff);
+      }
+      expected[length].push_back(sha256(message));
+    }
+  }
+  string reference = sha256(string(1000, 'z'));
+
+  for (SHA256::Core core : {SHA256::SCALAR, SHA256::AVX2, SHA256::SHANI}) {
+    if (!SHA256::forceCore(core)) {
+      continue;
+    }
+    CHECK(sha256(string(1000, 'z')) == reference);
+    for (size_t length : lengths) {
+      string input(length, 'q');
+      for (size_t i = 0; i < length; i++) {
+        input[i] = static_cast<char>(i * 31 + 1);
+      }
+      for (size_t n : {1, 8, 13, 17}) {
+        vector<uint8_t> out(n * SHA256::HashSize);
+        SHA256::hashCounter(reinterpret_cast<const uint8_t*>(input.data()),
+                            length, first, n, out.data());
+        for (size_t j = 0; j < n; j++) {
+          CHECK(hex(out.data() + j * SHA256::HashSize, SHA256::HashSize) ==
+                expected[length][j]);
+        }
+      }
+    }
+  }
+  SHA256::forceCore(detected);
+}
+
+TEST(hash, matrixIsDeterministicAndReduced) {
+  CryptoContext context(3329, 4, 1);
+  CryptoContext::Scope active(context);
+  Hash H(4, 9);
+  Matrix a = H.hash("id-1");
+  CHECK(a.getRows() == 4 && a.getCols() == 9);
+  CHECK(a == H.hash("id-1"));
+  CHECK(a != H.hash("id-2"));
+  for (unsigned int i = 0; i < a.getRows(); i++) {
+    for (unsigned int j = 0; j < a.getCols(); j++) {
+      CHECK(a.get(i, j) >= 0 && a.get(i, j) < 3329);
+    }
+  }
+}
+
+static string shake128(const string& input, size_t length) {
+  SHAKE128 shake;
+  shake.update(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  shake.finalize();
+  vector<uint8_t> out(length);
+  shake.squeeze(out.data(), length);
+  return hex(out.data(), length);
+}
+
+// FIPS 202 examples, first 32 output bytes
+TEST(hash, shake128KnownAnswers) {
+  CHECK(shake128("", 32) ==
+        "7f9c2ba4e88f827d616045507605853ed73b8093f6efbc88eb1a6eacfa66ef26");
+  CHECK(shake128("abc", 32) ==
+        "5881092dd818bf5cf8a3ddb793fbcba74097d5c526a6d35f97b83351940f2cc8");
+}
+
+// Squeezing in pieces that straddle the rate gives the same stream
+TEST(hash, shake128Squeeze) {
+  string stream = shake128("stream", 3 * SHAKE128::Rate + 5);
+  SHAKE128 shake;
+  shake.update(reinterpret_cast<const uint8_t*>("stream"), 6);
+  shake.finalize();
+  string pieces;
+  for (size_t length : {1, 166, 2, 200, 140}) {
+    vector<uint8_t> out(length);
+    shake.squeeze(out.data(), length);
+    pieces += hex(out.data(), length);
+  }
+  CHECK(pieces == stream.substr(0, pieces.size()));
+}
+
+TEST(hash, shake128MatrixIsReduced) {
+  CryptoContext context(3329, 4, 1);
+  CryptoContext::Scope active(context);
+  Hash H(8, 64, HashBackend::SHAKE128_XOF);
+  Matrix a = H.hash("epoch-3");
+  CHECK(a == H.hash("epoch-3"));
+  CHECK(a != Hash(8, 64).hash("epoch-3"));
+  bool high = false;
+  for (unsigned int i = 0; i < a.getRows(); i++) {
+    for (unsigned int j = 0; j < a.getCols(); j++) {
+      CHECK(a.get(i, j) >= 0 && a.get(i, j) < 3329);
+      high = high || a.get(i, j) >= 2048;
+    }
+  }
+  CHECK(high);
+}
+
+// A prefixed Hash continues from the absorbed midstate, for both backends
+// and for prefixes longer than a block
+TEST(hash, withPrefixMatchesConcatenation) {
+  CryptoContext context(3329, 4, 1);
+  CryptoContext::Scope active(context);
+  for (HashBackend backend :
+       {HashBackend::SHA256_CTR, HashBackend::SHAKE128_XOF}) {
+    Hash H(4, 20, backend);
+    for (string prefix : {string("7."), string(200, 'p')}) {
+      Hash prefixed = H.withPrefix(prefix);
+      CHECK(prefixed.hash("0110|3") == H.hash(prefix + "0110|3"));
+      // Reusing the prefixed copy does not disturb its midstate
+      CHECK(prefixed.hash("1001|4") == H.hash(prefix + "1001|4"));
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#include "Check.hpp"
+#include "IB-ME.hpp"
+
+// Keys are accepted only for the receiver and the epoch they were issued
+// for, and a revoked receiver gets no decryption key
+TEST(ibme, decryptionKeysAreBoundToReceiverAndEpoch) {
+  IBME ibme(4, make_shared<CryptoContext>(MODULUS, SIGMA, 7));
+  bitset<MESSAGE_LEN> message;
+  for (unsigned int i = 0; i < MESSAGE_LEN; i += 3) {
+    message.set(i);
+  }
+
+  Trapdoor ek = ibme.SKGen(0);
+  NodeKeys rk1 = ibme.RKGen(1);
+  NodeKeys rk2 = ibme.RKGen(2);
+  NodeKeys ku0 = ibme.KUpdGen(ibme.RL, 0);
+
+  DecryptionKey dk = ibme.DKGen(rk1, 1, ku0, 0);
+  ibme.checkDecryptionKey(dk, 1, 0);
+  Ciphertext ct = ibme.Enc(ek, 0, 1, message, 0);
+  CHECK(ibme.Dec(dk, 1, 0, ct) == message.to_string());
+
+  // another receiver's key, another epoch, or the two kinds swapped
+  CHECK_THROWS(ibme.DKGen(rk2, 1, ku0, 0));
+  CHECK_THROWS(ibme.DKGen(rk1, 1, ku0, 1));
+  CHECK_THROWS(ibme.DKGen(ku0, 0, rk1, 1));
+
+  // an update listed out of node order is bad input, not a revocation
+  ibme.KRev(3, 0);
+  NodeKeys reordered = ibme.KUpdGen(ibme.RL, 0);
+  CHECK(reordered.size() > 1);
+  reverse(reordered.begin(), reordered.end());
+  bool badInput = false;
+  try {
+    ibme.DKGen(rk1, 1, reordered, 0);
+  } catch (const invalid_argument&) {
+    badInput = true;
+  }
+  CHECK(badInput);
+
+  ibme.KRev(2, 1);
+  NodeKeys ku1 = ibme.KUpdGen(ibme.RL, 1);
+  CHECK_THROWS(ibme.DKGen(rk2, 2, ku1, 1));
+  ibme.checkDecryptionKey(ibme.DKGen(rk1, 1, ku1, 1), 1, 1);
+}
+
+// Warming more users than the default cache holds keeps every entry
+TEST(ibme, warmCacheKeepsEverything) {
+  IBME ibme(40, make_shared<CryptoContext>(MODULUS, SIGMA, 3));
+  ibme.warmCache(5, 4);
+  const MatrixCache& cache = ibme.getCache();
+  for (int id = 0; id < 40; id++) {
+    CHECK(cache.contains(MatrixCache::RECEIVER, id));
+    CHECK(cache.contains(MatrixCache::SENDER, id));
+  }
+  for (int t = 5; t < 9; t++) {
+    CHECK(cache.contains(MatrixCache::EPOCH, t));
+  }
+  CHECK(!cache.contains(MatrixCache::EPOCH, 9));
+}
+
+// Instances of different parameter sets run side by side in one binary
+TEST(ibme, parameterSetsSideBySide) {
+  IBME toy(4, make_shared<CryptoContext>(ToyParams::q, ToyParams::sigma, 1),
+           SchemeParams::of<ToyParams>());
+  IBME large(2, nullptr, SchemeParams::of<DefaultParams>());
+  CHECK(toy.getParams().n == ToyParams::n);
+  CHECK(large.getParams().n == DefaultParams::n);
+  CHECK(large.A.getRows() == DefaultParams::n);
+  CHECK(large.U_t.getRows() == DefaultParams::slots);
+  CHECK(toy.U_t.getRows() == ToyParams::slots);
+
+  // Each instance works with its own dimensions and context
+  string message = "110010100111";
+  Trapdoor ek = toy.SKGen(0);
+  NodeKeys rk = toy.RKGen(1);
+  NodeKeys ku = toy.KUpdGen(toy.RL, 0);
+  Ciphertext ct = toy.Enc(ek, 0, 1, message, 0);
+  Trapdoor ekLarge = large.SKGen(0);
+  Ciphertext ctLarge = large.Enc(ekLarge, 0, 1, message, 0);
+  CHECK(ctLarge.getSlots() == DefaultParams::slots);
+  CHECK(toy.Dec(toy.DKGen(rk, 1, ku, 0), 1, 0, ct) == message);
+  CHECK_THROWS(toy.Enc(ek, 0, 1, "1100", 0));
+}
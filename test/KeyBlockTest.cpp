@@ -0,0 +1,59 @@
+#include "Check.hpp"
+#include "KeyBlock.hpp"
+#include "Trapdoor.hpp"
+
+// Residues survive the centered int16 storage up to the largest modulus
+// that fits, including the extremes 0, q / 2, q / 2 + 1 and q - 1
+TEST(keyBlock, slotsRoundTrip) {
+  for (BigInt q : {3329, 65521, 65535}) {
+    CryptoContext context(q, 8, 1);
+    CryptoContext::Scope active(context);
+    Matrix E = Matrix::generateUniformRandomMatrix(6, 5);
+    E.set(0, 0, 0);
+    E.set(1, 1, q / 2);
+    E.set(2, 2, q / 2 + 1);
+    E.set(3, 3, q - 1);
+    KeyBlock block(9, 6);
+    block.setSlots(2, E);
+    CHECK(block.getSlotBlock(2, 5) == E);
+    CHECK(block.getSlot(5) == E.getColVector(3));
+    CHECK(block.get(4, 2) == q / 2 + 1);
+    CHECK_THROWS(block.setSlots(5, E));
+    CHECK_THROWS(block.get(9, 0));
+  }
+}
+
+TEST(keyBlock, rejectsModuliBeyondInt16) {
+  CryptoContext context(65536, 8, 1);
+  CryptoContext::Scope active(context);
+  CHECK_THROWS(KeyBlock(1, 2));
+  CHECK_THROWS(Trapdoor(Matrix(2, 2)));
+}
+
+// innerProducts is rk_i^T [c0; c1] + ku_i^T [c0; c2] for every slot
+TEST(keyBlock, innerProductsMatchMatrixProducts) {
+  CryptoContext context(3329, 8, 1);
+  CryptoContext::Scope active(context);
+  const unsigned int slots = 37, length = 8, half = length / 2;
+  Matrix R = Matrix::generateUniformRandomMatrix(length, slots);
+  Matrix U = Matrix::generateUniformRandomMatrix(length, slots);
+  KeyBlock rk(slots, length), ku(slots, length);
+  rk.setSlots(0, R);
+  ku.setSlots(0, U);
+  Matrix c = Matrix::generateUniformRandomMatrix(3 * half, 1);
+  vector<BigInt> out(slots);
+  KeyBlock::innerProducts(rk, ku, c.rowData(0), out.data());
+
+  // c = [c0; c1; c2] with blocks of half entries
+  Matrix c01(length, 1), c02(length, 1);
+  for (unsigned int r = 0; r < length; r++) {
+    c01.set(r, 0, c.get(r, 0));
+    c02.set(r, 0, c.get(r < half ? r : r + half, 0));
+  }
+  Matrix want = R.transpose() * c01 + U.transpose() * c02;
+  for (unsigned int i = 0; i < slots; i++) {
+    CHECK(out[i] == want.get(i, 0));
+  }
+  CHECK_THROWS(KeyBlock::innerProducts(rk, KeyBlock(slots, 6), c.rowData(0),
+                                       out.data()));
+}
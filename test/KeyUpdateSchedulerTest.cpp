@@ -0,0 +1,111 @@
+#include <chrono>
+#include <thread>
+
+#include "Check.hpp"
+#include "KeyUpdateScheduler.hpp"
+
+static shared_ptr<IBME> makeIBME(uint64_t seed) {
+  return make_shared<IBME>(4, make_shared<CryptoContext>(MODULUS, SIGMA, seed));
+}
+
+// Nodes of a key update, to compare it with the cover of an epoch
+static vector<TreeNode*> nodesOf(const NodeKeys& keys) {
+  vector<TreeNode*> nodes;
+  for (const auto& key : keys) {
+    nodes.push_back(key.first);
+  }
+  return nodes;
+}
+
+// Wait up to a minute for the background to finish epoch t
+static bool waitReady(const KeyUpdateScheduler& scheduler, int t) {
+  for (int i = 0; i < 6000 && !scheduler.isReady(t); i++) {
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  return scheduler.isReady(t);
+}
+
+// A prebuilt update covers the same nodes as KUpdGen and yields working
+// decryption keys
+TEST(keyUpdateScheduler, publishesThePreparedUpdate) {
+  shared_ptr<IBME> ibme = makeIBME(11);
+  NodeKeys rk = ibme->RKGen(1);
+  ibme->KRev(3, 0);
+  KeyUpdateScheduler scheduler(*ibme, 2);
+  CHECK(scheduler.latest() == nullptr);
+  scheduler.prepare(0);
+  CHECK(waitReady(scheduler, 0));
+  shared_ptr<const NodeKeys> update = scheduler.publish(0);
+  CHECK(nodesOf(*update) == ibme->tree.KUNodes(ibme->RL, 0));
+  CHECK(nodesOf(*update) == nodesOf(ibme->KUpdGen(ibme->RL, 0)));
+  ibme->checkDecryptionKey(ibme->DKGen(rk, 1, *update, 0), 1, 0);
+  CHECK(scheduler.latest() == update);
+  CHECK(scheduler.latestEpoch() == 0);
+  // Publishing the same epoch again hands out the same update
+  CHECK(scheduler.publish(0) == update);
+}
+
+// A revocation after prepare makes the snapshot stale, publish rebuilds
+TEST(keyUpdateScheduler, revocationAfterPrepareFallsBack) {
+  shared_ptr<IBME> ibme = makeIBME(12);
+  NodeKeys rk2 = ibme->RKGen(2);
+  NodeKeys rk1 = ibme->RKGen(1);
+  KeyUpdateScheduler scheduler(*ibme);
+  scheduler.prepare(1);
+  ibme->KRev(2, 1);
+  shared_ptr<const NodeKeys> update = scheduler.publish(1);
+  CHECK(nodesOf(*update) == ibme->tree.KUNodes(ibme->RL, 1));
+  CHECK_THROWS(ibme->DKGen(rk2, 2, *update, 1));
+  ibme->checkDecryptionKey(ibme->DKGen(rk1, 1, *update, 1), 1, 1);
+}
+
+// Nothing is built while paused, and publish finishes the work itself
+TEST(keyUpdateScheduler, pauseHoldsTheBackground) {
+  shared_ptr<IBME> ibme = makeIBME(13);
+  NodeKeys rk = ibme->RKGen(0);
+  KeyUpdateScheduler scheduler(*ibme);
+  scheduler.pause();
+  scheduler.prepare(2);
+  this_thread::sleep_for(chrono::milliseconds(200));
+  CHECK(!scheduler.isReady(2));
+  shared_ptr<const NodeKeys> update = scheduler.publish(2);
+  CHECK(scheduler.isReady(2));
+  ibme->checkDecryptionKey(ibme->DKGen(rk, 0, *update, 2), 0, 2);
+
+  scheduler.prepare(3);
+  scheduler.resume();
+  CHECK(waitReady(scheduler, 3));
+}
+
+// Preparing the next epoch drops the job of the previous one
+TEST(keyUpdateScheduler, prepareDropsTheEarlierJob) {
+  shared_ptr<IBME> ibme = makeIBME(14);
+  NodeKeys rk = ibme->RKGen(3);
+  KeyUpdateScheduler scheduler(*ibme);
+  scheduler.pause();
+  scheduler.prepare(4);
+  scheduler.prepare(5);
+  scheduler.resume();
+  CHECK(waitReady(scheduler, 5));
+  CHECK(!scheduler.isReady(4));
+  // The dropped epoch is still served, by KUpdGen
+  shared_ptr<const NodeKeys> update = scheduler.publish(4);
+  ibme->checkDecryptionKey(ibme->DKGen(rk, 3, *update, 4), 3, 4);
+}
+
+// Destroying the scheduler with a job in flight stops its runners
+TEST(keyUpdateScheduler, destroyWithJobInFlight) {
+  shared_ptr<IBME> ibme = makeIBME(15);
+  for (int round = 0; round < 3; round++) {
+    KeyUpdateScheduler scheduler(*ibme, 2);
+    scheduler.prepare(round);
+    this_thread::sleep_for(chrono::milliseconds(5 * round));
+  }
+  {
+    KeyUpdateScheduler scheduler(*ibme);
+    scheduler.pause();
+    scheduler.prepare(7);
+  }
+  // The instance is still usable afterwards
+  CHECK(ibme->KUpdGen(ibme->RL, 7).size() == 1);
+}
@@ -0,0 +1,74 @@
+#include "Check.hpp"
+#include "MP12.hpp"
+
+// Every table sample sits in the bucket of its residue and the ORACLE method
+// answers from those buckets
+TEST(mp12, oracleTableIsGroupedByResidue) {
+  CryptoContext context(257, 8, 3);
+  CryptoContext::Scope active(context);
+  const CryptoContext::OracleTable& table = context.getOracleTable();
+  BigInt q = 257;
+  unsigned int k = context.getK();
+  CHECK(table.k == k);
+  CHECK(table.offsets.size() == static_cast<size_t>(q) + 1);
+  CHECK(table.offsets.back() * k == table.samples.size());
+  for (BigInt u = 0; u < q; u++) {
+    for (unsigned int s = table.offsets[u]; s < table.offsets[u + 1]; s++) {
+      BigInt r = 0;
+      for (unsigned int i = 0; i < k; i++) {
+        r += table.samples[static_cast<size_t>(s) * k + i] << i;
+      }
+      CHECK(r % q == u);
+    }
+  }
+
+  MP12::setGInverseMethod(MP12::ORACLE);
+  BigInt x[64];
+  for (BigInt u = -3; u < q; u += 5) {
+    MP12::gInverse(u, x);
+    BigInt r = 0;
+    for (unsigned int i = 0; i < k; i++) {
+      r += x[i] << i;
+    }
+    CHECK(((r - u) % q + q) % q == 0);
+  }
+}
+
+// A [R; I] G^-1(U) = G G^-1(U) = U for A = [B | G - B R]
+TEST(mp12, fAInverseBatchIsAPreimage) {
+  CryptoContext context(3329, 408, 4);
+  CryptoContext::Scope active(context);
+  unsigned int n = 3;
+  pair<Matrix, Matrix> trap = MP12::trapGen(n);
+  Matrix U = Matrix::generateUniformRandomMatrix(n, 17);
+  Matrix X(trap.second.getRows() + trap.second.getCols(), U.getCols());
+  MP12::fAInverseBatch(trap.second, U, X);
+  CHECK(trap.first * X == U);
+  Matrix wrong(X.getRows() + 1, U.getCols());
+  CHECK_THROWS(MP12::fAInverseBatch(trap.second, U, wrong));
+}
+
+// Column j of the batch is a preimage of column j of U under [I | A | M1]
+TEST(mp12, sampleLeftBatchIsAPreimage) {
+  CryptoContext context(3329, 408, 9);
+  CryptoContext::Scope active(context);
+  unsigned int n = 2;
+  pair<Matrix, Matrix> trap = MP12::trapGenHNF(n);
+  Trapdoor T(trap.second);
+  Matrix M1 = Matrix::generateUniformRandomMatrix(n, 30);
+  Matrix U = Matrix::generateUniformRandomMatrix(n, 6);
+  Matrix E = MP12::SampleLeftBatch(trap.first, M1, T, U);
+  CHECK(E.getRows() == T.getPreimageRows() + M1.getCols());
+  Matrix full = Matrix::horizontalConcat(trap.first, M1);
+  CHECK(Matrix::multiplyHNF(full, E) == U);
+
+  PerturbationPool pool(n, M1.getCols(), 408, 8, 0);
+  CHECK(Matrix::multiplyHNF(full, MP12::SampleLeftBatch(trap.first, M1, T, U,
+                                                        &pool)) == U);
+  // Shapes that do not fit A are rejected
+  CHECK_THROWS(MP12::SampleLeftBatch(trap.first.getColBlock(0, 5), M1, T, U));
+  CHECK_THROWS(MP12::SampleLeftBatch(
+      trap.first, M1, T, Matrix::generateUniformRandomMatrix(n + 1, 1)));
+  PerturbationPool wrong(n, 3, 408, 8, 0);
+  CHECK_THROWS(MP12::SampleLeftBatch(trap.first, M1, T, U, &wrong));
+}
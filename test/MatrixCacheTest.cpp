@@ -0,0 +1,61 @@
+#include "Check.hpp"
+#include "MatrixCache.hpp"
+
+static Matrix filled(BigInt value) {
+  Matrix m(1, 1);
+  m.rowData(0)[0] = value;
+  return m;
+}
+
+TEST(matrixCache, buildsOncePerKey) {
+  MatrixCache cache(4);
+  int builds = 0;
+  auto build = [&]() {
+    builds++;
+    return filled(7);
+  };
+  shared_ptr<const Matrix> a = cache.get(MatrixCache::RECEIVER, 1, build);
+  shared_ptr<const Matrix> b = cache.get(MatrixCache::RECEIVER, 1, build);
+  CHECK(builds == 1);
+  CHECK(a == b);
+  // Same id under another kind is a different entry
+  cache.get(MatrixCache::EPOCH, 1, build);
+  CHECK(builds == 2);
+  CHECK(cache.size() == 2);
+}
+
+TEST(matrixCache, evictsLeastRecentlyUsed) {
+  MatrixCache cache(3);
+  for (int id = 0; id < 3; id++) {
+    cache.get(MatrixCache::EPOCH, id, [&]() { return filled(id); });
+  }
+  shared_ptr<const Matrix> held =
+      cache.get(MatrixCache::EPOCH, 1, []() { return filled(-1); });
+  CHECK(held->rowData(0)[0] == 1);
+  // Touch 0 and 2, so 1 is now the oldest entry
+  cache.get(MatrixCache::EPOCH, 0, []() { return filled(-1); });
+  cache.get(MatrixCache::EPOCH, 2, []() { return filled(-1); });
+  cache.get(MatrixCache::EPOCH, 3, []() { return filled(3); });
+  CHECK(cache.size() == 3);
+  CHECK(!cache.contains(MatrixCache::EPOCH, 1));
+  CHECK(cache.contains(MatrixCache::EPOCH, 0));
+  CHECK(cache.contains(MatrixCache::EPOCH, 2));
+  CHECK(cache.contains(MatrixCache::EPOCH, 3));
+  // An evicted matrix stays valid for the callers holding it
+  CHECK(held->rowData(0)[0] == 1);
+  cache.clear();
+  CHECK(cache.size() == 0);
+}
+
+TEST(matrixCache, reserveOnlyGrows) {
+  MatrixCache cache(2);
+  cache.reserve(5);
+  CHECK(cache.getCapacity() == 5);
+  cache.reserve(3);
+  CHECK(cache.getCapacity() == 5);
+  for (int id = 0; id < 5; id++) {
+    cache.get(MatrixCache::SENDER, id, [&]() { return filled(id); });
+  }
+  CHECK(cache.size() == 5);
+  CHECK(cache.contains(MatrixCache::SENDER, 0));
+}
@@ -0,0 +1,62 @@
+#include "Check.hpp"
+#include "Matrix.hpp"
+
+static Matrix naiveProduct(const Matrix& A, const Matrix& B) {
+  BigInt q = Matrix::getModulus();
+  Matrix C(A.getRows(), B.getCols());
+  for (unsigned int i = 0; i < A.getRows(); i++) {
+    for (unsigned int j = 0; j < B.getCols(); j++) {
+      BigInt sum = 0;
+      for (unsigned int l = 0; l < A.getCols(); l++) {
+        sum = (sum + A.get(i, l) * B.get(l, j)) % q;
+      }
+      C.set(i, j, sum);
+    }
+  }
+  return C;
+}
+
+// The blocked product matches the textbook one on shapes that do not divide
+// the tile sizes, and for moduli with and without a specialized kernel
+TEST(matrix, blockedProductMatchesNaive) {
+  for (BigInt q : {3329, 7681, 1000003}) {
+    CryptoContext context(q, 8, 2);
+    CryptoContext::Scope active(context);
+    for (unsigned int shape : {1u, 7u, 70u, 131u}) {
+      Matrix A = Matrix::generateUniformRandomMatrix(5, shape);
+      Matrix B = Matrix::generateUniformRandomMatrix(shape, 67);
+      CHECK(A * B == naiveProduct(A, B));
+    }
+  }
+}
+
+TEST(matrix, rowsAreContiguous) {
+  CryptoContext context(3329, 8, 2);
+  CryptoContext::Scope active(context);
+  Matrix A = Matrix::generateUniformRandomMatrix(4, 9);
+  for (unsigned int i = 0; i < 4; i++) {
+    CHECK(A.rowData(i) == A.rowData(0) + i * 9);
+    for (unsigned int j = 0; j < 9; j++) {
+      CHECK(A.rowData(i)[j] == A.get(i, j));
+    }
+  }
+  A.set(2, 3, -1);
+  CHECK(A.get(2, 3) == 3328);
+  CHECK_THROWS(A.get(4, 0));
+}
+
+// Products with [I | tail] skip the identity block but agree with the
+// explicit matrix
+TEST(matrix, hnfProductsMatchExplicitIdentity) {
+  CryptoContext context(3329, 8, 2);
+  CryptoContext::Scope active(context);
+  unsigned int n = 6;
+  Matrix tail = Matrix::generateUniformRandomMatrix(n, 29);
+  Matrix full =
+      Matrix::horizontalConcat(Matrix::generateIdentityMatrix(n), tail);
+  Matrix x = Matrix::generateUniformRandomMatrix(n + 29, 3);
+  CHECK(Matrix::multiplyHNF(tail, x) == full * x);
+  Matrix s = Matrix::generateUniformRandomMatrix(n, 4);
+  CHECK(Matrix::transposeMultiplyHNF(tail, s) == full.transpose() * s);
+  CHECK_THROWS(Matrix::multiplyHNF(tail, s));
+}
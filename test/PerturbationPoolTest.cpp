@@ -0,0 +1,102 @@
+#include <chrono>
+#include <thread>
+
+#include "BoundedQueue.hpp"
+#include "Check.hpp"
+#include "MP12.hpp"
+#include "PerturbationPool.hpp"
+
+TEST(boundedQueue, isBoundedFifo) {
+  CHECK_THROWS(BoundedQueue<int>(0));
+  BoundedQueue<int> queue(5);
+  CHECK(queue.capacity() == 8);
+  int value = 0;
+  CHECK(!queue.tryPop(value));
+  for (int i = 0; i < 8; i++) {
+    CHECK(queue.tryPush(int(i)));
+  }
+  CHECK(!queue.tryPush(99));
+  CHECK(queue.size() == 8);
+  for (int i = 0; i < 8; i++) {
+    CHECK(queue.tryPop(value) && value == i);
+  }
+  CHECK(!queue.tryPop(value));
+}
+
+// Every pushed value is popped exactly once under concurrent producers and
+// consumers
+TEST(boundedQueue, popsEveryValueOnce) {
+  BoundedQueue<int> queue(16);
+  const int perProducer = 20000, producers = 3, consumers = 3;
+  atomic<long long> sum(0);
+  atomic<int> popped(0);
+  vector<thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]() {
+      for (int i = 1; i <= perProducer; i++) {
+        while (!queue.tryPush(p * perProducer + i)) {
+          this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < consumers; c++) {
+    threads.emplace_back([&]() {
+      int value;
+      while (popped.load() < producers * perProducer) {
+        if (queue.tryPop(value)) {
+          sum += value;
+          popped++;
+        } else {
+          this_thread::yield();
+        }
+      }
+    });
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+  long long total = static_cast<long long>(producers) * perProducer;
+  CHECK(popped.load() == total);
+  CHECK(sum.load() == total * (total + 1) / 2);
+}
+
+static bool isGadgetPerturbation(const BigInt* p, unsigned int k) {
+  // Perturbations are small integers, not residues mod q
+  for (unsigned int i = 0; i < k; i++) {
+    if (p[i] < -3329 / 2 || p[i] > 3329 / 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(perturbationPool, fillsUpAndServesItems) {
+  CryptoContext context(3329, 408, 8);
+  CryptoContext::Scope active(context);
+  unsigned int k = context.getK();
+  PerturbationPool pool(2, 5, 3.0, 4, 1);
+  CHECK(pool.getGadgetLength() == 2 * k);
+  CHECK(pool.getExtraLength() == 5);
+  // The producer runs under the context the pool was created in
+  for (int wait = 0; wait < 2000 && pool.available() < 4; wait++) {
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  CHECK(pool.available() == 4);
+
+  vector<BigInt> item;
+  CHECK(pool.tryTake(item));
+  CHECK(item.size() == 2 * k + 5);
+  CHECK(isGadgetPerturbation(item.data(), 2 * k));
+}
+
+TEST(perturbationPool, computesInlineWhenEmpty) {
+  CryptoContext context(3329, 408, 8);
+  CryptoContext::Scope active(context);
+  PerturbationPool pool(3, 0, 0, 2, 0);
+  vector<BigInt> item;
+  CHECK(!pool.tryTake(item));
+  pool.take(item);
+  CHECK(item.size() == pool.getGadgetLength());
+  CHECK(isGadgetPerturbation(item.data(), item.size()));
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <set>
+
+#include "Check.hpp"
+#include "RevocationList.hpp"
+#include "Tree.hpp"
+
+// Whether some leaf below heap node v is revoked
+static bool hasRevokedLeaf(unsigned int v, unsigned int capacity,
+                           const set<unsigned int>& revoked) {
+  if (v + 1 >= capacity) {
+    return revoked.count(v - (capacity - 1)) != 0;
+  }
+  return hasRevokedLeaf(BinaryTree::left(v), capacity, revoked) ||
+         hasRevokedLeaf(BinaryTree::right(v), capacity, revoked);
+}
+
+// Complete-subtree cover computed from scratch: the nodes without a revoked
+// leaf below them whose parent has one, or the root if nothing is revoked
+static vector<unsigned int> bruteForceCover(unsigned int capacity,
+                                            const set<unsigned int>& revoked) {
+  vector<unsigned int> cover;
+  for (unsigned int v = 0; v < 2 * capacity - 1; v++) {
+    if (!hasRevokedLeaf(v, capacity, revoked) &&
+        (v == 0 || hasRevokedLeaf(BinaryTree::parent(v), capacity, revoked))) {
+      cover.push_back(v);
+    }
+  }
+  return cover;
+}
+
+// Users whose leaf lies below one of the cover nodes
+static set<unsigned int> coveredUsers(unsigned int capacity,
+                                      const vector<unsigned int>& cover) {
+  set<unsigned int> users;
+  for (unsigned int i = 0; i < capacity; i++) {
+    unsigned int v = capacity - 1 + i;
+    while (true) {
+      if (find(cover.begin(), cover.end(), v) != cover.end()) {
+        users.insert(i);
+      }
+      if (v == 0) {
+        break;
+      }
+      v = BinaryTree::parent(v);
+    }
+  }
+  return users;
+}
+
+// Revoke users at random epochs and compare the incremental cover with the
+// brute-force one at every epoch, going forward and then backward
+TEST(revocationList, coverMatchesBruteForce) {
+  for (unsigned int capacity : {1u, 2u, 7u, 8u, 13u}) {
+    RevocationList RL(capacity);
+    vector<int> since(capacity, INT_MAX);
+    mt19937 gen(capacity);
+    for (unsigned int i = 0; i < capacity; i++) {
+      if (gen() % 3 != 0) {
+        since[i] = gen() % 10;
+        RL.revoke(i, since[i]);
+      }
+    }
+    vector<int> epochs;
+    for (int t = -1; t <= 10; t++) {
+      epochs.push_back(t);
+    }
+    for (int t = 10; t >= -1; t--) {
+      epochs.push_back(t);
+    }
+    for (int t : epochs) {
+      set<unsigned int> revoked;
+      for (unsigned int i = 0; i < capacity; i++) {
+        if (since[i] <= t) {
+          revoked.insert(i);
+        }
+      }
+      vector<unsigned int> cover = RL.cover(t);
+      CHECK(cover == bruteForceCover(capacity, revoked));
+      CHECK(RL.count(t) == revoked.size());
+      set<unsigned int> users = coveredUsers(capacity, cover);
+      for (unsigned int i = 0; i < capacity; i++) {
+        CHECK((users.count(i) != 0) == (revoked.count(i) == 0));
+      }
+    }
+  }
+}
+
+// With every user revoked the cover is empty
+TEST(revocationList, allRevoked) {
+  RevocationList RL(6);
+  for (unsigned int i = 0; i < 6; i++) {
+    RL.revoke(i, i);
+  }
+  CHECK(RL.cover(4).size() != 0);
+  CHECK(RL.cover(5).empty());
+  CHECK(RL.count(5) == 6);
+  CHECK(RL.cover(0) == bruteForceCover(6, {0}));
+}
+
+TEST(revocationList, revokeKeepsTheEarliestEpoch) {
+  RevocationList RL(4);
+  RL.revoke(1, 5);
+  RL.revoke(1, 8);
+  CHECK(RL.revokedAt(1) == 5);
+  CHECK(RL.cover(6) == bruteForceCover(4, {1}));
+  RL.revoke(1, 2);
+  CHECK(RL.revokedAt(1) == 2);
+  CHECK(RL.count(3) == 1);
+  CHECK(RL.revokedAt(0) == INT_MAX);
+  CHECK_THROWS(RL.revoke(4, 0));
+  CHECK_THROWS(RL.revokedAt(4));
+}
+
+// An expired entry leaves the cover, whether or not it is active yet
+TEST(revocationList, expireDropsEntries) {
+  RevocationList RL(8);
+  RL.revoke({2, 3}, 1);
+  RL.revoke(6, 4);
+  CHECK(RL.count(2) == 2);
+  RL.expire({3, 6});
+  CHECK(RL.revokedAt(3) == INT_MAX);
+  CHECK(RL.count(2) == 1);
+  CHECK(RL.cover(5) == bruteForceCover(8, {2}));
+  RL.expire({3});
+  CHECK(RL.count(5) == 1);
+  CHECK_THROWS(RL.expire({8}));
+}
+
+// KUNodes hands out the tree payloads of the cover
+TEST(revocationList, kuNodesMapsTheCover) {
+  BinaryTree tree(7);
+  RevocationList RL(7);
+  RL.revoke({0, 4}, 3);
+  vector<TreeNode*> nodes = tree.KUNodes(RL, 3);
+  vector<unsigned int> cover = RL.cover(3);
+  CHECK(nodes.size() == cover.size());
+  for (size_t i = 0; i < nodes.size(); i++) {
+    CHECK(tree.indexOf(nodes[i]) == cover[i]);
+  }
+  CHECK(tree.KUNodes(RL, 2).size() == 1);
+  CHECK_THROWS(tree.KUNodes(RevocationList(8), 0));
+}
@@ -0,0 +1,38 @@
+#include <cstring>
+#include <iostream>
+
+#include "Check.hpp"
+
+vector<TestCase>& testCases() {
+  static vector<TestCase> cases;
+  return cases;
+}
+
+// usage: unitTests [group...]
+int main(int argc, char** argv) {
+  int failed = 0, run = 0;
+  for (const TestCase& test : testCases()) {
+    bool selected = argc == 1;
+    for (int i = 1; i < argc; i++) {
+      selected = selected || strcmp(argv[i], test.group) == 0;
+    }
+    if (!selected) {
+      continue;
+    }
+    run++;
+    try {
+      test.body();
+      cout << "[ OK ] " << test.group << "." << test.name << endl;
+    } catch (const exception& e) {
+      failed++;
+      cout << "[FAIL] " << test.group << "." << test.name << ": " << e.what()
+           << endl;
+    }
+  }
+  if (run == 0) {
+    cout << "no test selected" << endl;
+    return 1;
+  }
+  cout << run - failed << "/" << run << " passed" << endl;
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include "Check.hpp"
+#include "ThreadPool.hpp"
+
+TEST(threadPool, parallelForVisitsEveryIndexOnce) {
+  ThreadPool pool(4);
+  for (size_t grain : {1, 3, 64, 1000}) {
+    vector<atomic<int>> visits(517);
+    pool.parallelFor(0, visits.size(), [&](size_t i) { visits[i]++; }, grain);
+    for (atomic<int>& v : visits) {
+      CHECK(v.load() == 1);
+    }
+  }
+  // An empty range runs nothing
+  pool.parallelFor(5, 5, [](size_t) { throw runtime_error("ran"); });
+}
+
+TEST(threadPool, parallelForRethrows) {
+  ThreadPool pool(3);
+  atomic<int> visited(0);
+  bool caught = false;
+  try {
+    pool.parallelFor(0, 100, [&](size_t i) {
+      visited++;
+      if (i == 42) {
+        throw invalid_argument("index 42");
+      }
+    });
+  } catch (const invalid_argument& e) {
+    caught = string(e.what()) == "index 42";
+  }
+  CHECK(caught);
+  // The other chunks still ran and the pool is still usable
+  CHECK(visited.load() == 100);
+  CHECK(pool.submit([]() { return 7; }).get() == 7);
+}
+
+// Loops nested in tasks of the same pool finish even when every worker is
+// busy with an outer iteration, since each caller works on its own loop
+TEST(threadPool, nestedLoopsDoNotDeadlock) {
+  ThreadPool pool(2);
+  atomic<int> total(0);
+  pool.parallelFor(0, 8, [&](size_t) {
+    ThreadPool::instance().parallelFor(0, 50, [&](size_t) { total++; });
+  });
+  CHECK(total.load() == 400);
+
+  vector<future<int>> results;
+  for (int t = 0; t < 6; t++) {
+    results.push_back(pool.submit([&pool, t]() {
+      atomic<int> sum(0);
+      pool.parallelFor(0, 10, [&](size_t i) { sum += static_cast<int>(i); });
+      return sum.load() + t;
+    }));
+  }
+  for (int t = 0; t < 6; t++) {
+    CHECK(results[t].get() == 45 + t);
+  }
+}
+
+TEST(threadPool, submitPropagatesExceptions) {
+  ThreadPool pool(1);
+  future<int> result = pool.submit([]() -> int { throw out_of_range("x"); });
+  CHECK_THROWS(result.get());
+}
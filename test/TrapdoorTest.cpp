@@ -0,0 +1,44 @@
+#include "Check.hpp"
+#include "MP12.hpp"
+#include "Trapdoor.hpp"
+
+TEST(trapdoor, compactsLosslessly) {
+  CryptoContext context(3329, 408, 6);
+  CryptoContext::Scope active(context);
+  pair<Matrix, Matrix> trap = MP12::trapGen(2);
+  Trapdoor T(trap.second);
+  CHECK(T.getRows() == trap.second.getRows());
+  CHECK(T.getCols() == trap.second.getCols());
+  CHECK(T.getPreimageRows() == T.getRows() + T.getCols());
+  CHECK(T.toMatrix() == trap.second);
+}
+
+TEST(trapdoor, preimagesMapToTheTargets) {
+  CryptoContext context(3329, 408, 6);
+  CryptoContext::Scope active(context);
+  pair<Matrix, Matrix> trap = MP12::trapGen(3);
+  Trapdoor T(trap.second);
+  Matrix U = Matrix::generateUniformRandomMatrix(3, 9);
+  Matrix X = T.preimage(U);
+  CHECK(X.getRows() == T.getPreimageRows() && X.getCols() == 9);
+  CHECK(trap.first * X == U);
+  // Single column with an explicit perturbation
+  vector<BigInt> p(T.getCols());
+  for (unsigned int i = 0; i < 3; i++) {
+    MP12::gadgetPerturbation(p.data() + i * context.getK());
+  }
+  Matrix u = U.getColVector(4);
+  CHECK(trap.first * T.preimage(u, p.data()) == u);
+  CHECK_THROWS(T.preimage(Matrix::generateUniformRandomMatrix(2, 1)));
+}
+
+// Preimages of an HNF trapdoor are preimages of [I | A]
+TEST(trapdoor, hnfPreimages) {
+  CryptoContext context(3329, 408, 6);
+  CryptoContext::Scope active(context);
+  pair<Matrix, Matrix> trap = MP12::trapGenHNF(3);
+  Trapdoor T(trap.second);
+  CHECK(trap.first.getCols() + 3 == T.getPreimageRows());
+  Matrix U = Matrix::generateUniformRandomMatrix(3, 5);
+  CHECK(Matrix::multiplyHNF(trap.first, T.preimage(U)) == U);
+}
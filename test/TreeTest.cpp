@@ -0,0 +1,37 @@
+#include "Check.hpp"
+#include "Tree.hpp"
+
+// Heap index arithmetic for a capacity that is not a power of two, so the
+// leaves sit on two levels
+TEST(tree, heapLayout) {
+  BinaryTree tree(5);
+  CHECK(tree.getCapacity() == 5);
+  CHECK(tree.size() == 9);
+  for (unsigned int v = 1; v < tree.size(); v++) {
+    unsigned int p = BinaryTree::parent(v);
+    CHECK(BinaryTree::left(p) == v || BinaryTree::right(p) == v);
+    CHECK(!tree.isLeaf(p));
+  }
+  for (unsigned int i = 0; i < 5; i++) {
+    unsigned int v = tree.leafIndex(i);
+    CHECK(tree.isLeaf(v));
+    CHECK(tree.findithLeaf(i) == tree.node(v));
+    CHECK(tree.indexOf(tree.node(v)) == v);
+  }
+  CHECK(tree.findithLeaf(5) == nullptr);
+  CHECK(tree.findithLeaf(-1) == nullptr);
+}
+
+TEST(tree, pathsRunFromTheRoot) {
+  BinaryTree tree(8);
+  CHECK(tree.pathIndices(0) == vector<unsigned int>({0}));
+  CHECK(tree.pathIndices(tree.leafIndex(5)) ==
+        vector<unsigned int>({0, 2, 5, 12}));
+  vector<TreeNode*> nodes = tree.path(tree.findithLeaf(5));
+  CHECK(nodes.size() == 4);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    CHECK(tree.indexOf(nodes[i]) == tree.pathIndices(12)[i]);
+  }
+  TreeNode outside;
+  CHECK_THROWS(tree.indexOf(&outside));
+}